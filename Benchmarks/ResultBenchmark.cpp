@@ -0,0 +1,312 @@
+// File: ResultBenchmark.cpp
+// Description: Measures what Result costs next to std::optional, std::expected (when the standard library has it)
+//                  and plain error codes, for constructing, propagating through a call chain, and map chains. Each is
+//                  run with no errors, a few errors, and half errors, across payload sizes.
+// Author: Matthew Krueger <mckrueg@bgsu.edu>
+
+#include <mktl/Result.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <random>
+#include <vector>
+
+#if defined(__has_include)
+#   if __has_include(<version>)
+#       include <version>
+#   endif
+#endif
+
+#if defined(__cpp_lib_expected)
+#   include <expected>
+#   define MKTL_BENCHMARK_EXPECTED 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#   define BENCHMARK_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#   define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+#   define BENCHMARK_NOINLINE
+#endif
+
+using namespace mckrueg::stl;
+
+namespace{
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::size_t INPUT_COUNT = 1 << 18;
+    constexpr int REPETITIONS = 5;
+
+    enum class ErrorCode : std::uint8_t{
+        None,
+        Invalid
+    };
+
+    // Inputs are uniform in [0, 1000), anything below the threshold fails. Not const, so it cannot be folded.
+    std::uint32_t g_ErrorThreshold = 0;
+
+    template<std::size_t Bytes>
+    struct Payload{
+        std::uint64_t words[Bytes / sizeof(std::uint64_t)];
+    };
+
+    template<std::size_t Bytes>
+    inline Payload<Bytes> make_payload(std::uint32_t input){
+        Payload<Bytes> payload{};
+        for(std::uint64_t& word : payload.words){
+            word = input;
+        }
+        return payload;
+    }
+
+    template<std::size_t Bytes>
+    inline Payload<Bytes> bump(Payload<Bytes> payload){
+        payload.words[0] += 1;
+        return payload;
+    }
+
+    template<std::size_t Bytes>
+    inline std::uint64_t checksum(const Payload<Bytes>& payload){
+        return payload.words[0] ^ payload.words[Bytes / sizeof(std::uint64_t) - 1];
+    }
+
+    /**
+     * Each style makes a payload (or fails), passes it up three more calls that each touch it, and maps it three
+     * times. Every layer is out of line so the returns actually happen.
+     */
+    template<std::size_t Bytes>
+    struct ResultStyle{
+        using P = Payload<Bytes>;
+        using R = Result<P, ErrorCode>;
+
+        static constexpr const char* NAME = "Result";
+
+        BENCHMARK_NOINLINE static R make(std::uint32_t input){
+            if(input < g_ErrorThreshold) return R(ErrorCode::Invalid);
+            return R(make_payload<Bytes>(input));
+        }
+
+        BENCHMARK_NOINLINE static R forward(R (*next)(std::uint32_t), std::uint32_t input){
+            R result = next(input);
+            if(result.is_err()) return result;
+            return R(bump(result.unwrap()));
+        }
+
+        static R level1(std::uint32_t input){ return forward(make, input); }
+        static R level2(std::uint32_t input){ return forward(level1, input); }
+
+        static std::uint64_t construct(std::uint32_t input){
+            return make(input).template map<std::uint64_t>([](const P& payload){ return checksum(payload); }).unwrap_or(0);
+        }
+
+        static std::uint64_t propagate(std::uint32_t input){
+            return forward(level2, input).template map<std::uint64_t>([](const P& payload){ return checksum(payload); }).unwrap_or(0);
+        }
+
+        static std::uint64_t map_chain(std::uint32_t input){
+            return make(input)
+                    .template map<P>([](const P& payload){ return bump(payload); })
+                    .template map<P>([](const P& payload){ return bump(payload); })
+                    .template map<std::uint64_t>([](const P& payload){ return checksum(payload); })
+                    .unwrap_or(0);
+        }
+    };
+
+    template<std::size_t Bytes>
+    struct OptionalStyle{
+        using P = Payload<Bytes>;
+        using R = std::optional<P>;
+
+        static constexpr const char* NAME = "optional";
+
+        BENCHMARK_NOINLINE static R make(std::uint32_t input){
+            if(input < g_ErrorThreshold) return std::nullopt;
+            return make_payload<Bytes>(input);
+        }
+
+        BENCHMARK_NOINLINE static R forward(R (*next)(std::uint32_t), std::uint32_t input){
+            R result = next(input);
+            if(!result) return result;
+            return bump(*result);
+        }
+
+        static R level1(std::uint32_t input){ return forward(make, input); }
+        static R level2(std::uint32_t input){ return forward(level1, input); }
+
+        static std::uint64_t construct(std::uint32_t input){
+            R result = make(input);
+            return result ? checksum(*result) : 0;
+        }
+
+        static std::uint64_t propagate(std::uint32_t input){
+            R result = forward(level2, input);
+            return result ? checksum(*result) : 0;
+        }
+
+        static std::uint64_t map_chain(std::uint32_t input){
+            // No transform before C++ 23, written the way C++ 17 code would
+            R first = make(input);
+            if(!first) return 0;
+            R second = bump(*first);
+            R third = bump(*second);
+            return checksum(*third);
+        }
+    };
+
+#if defined(MKTL_BENCHMARK_EXPECTED)
+
+    template<std::size_t Bytes>
+    struct ExpectedStyle{
+        using P = Payload<Bytes>;
+        using R = std::expected<P, ErrorCode>;
+
+        static constexpr const char* NAME = "expected";
+
+        BENCHMARK_NOINLINE static R make(std::uint32_t input){
+            if(input < g_ErrorThreshold) return std::unexpected(ErrorCode::Invalid);
+            return make_payload<Bytes>(input);
+        }
+
+        BENCHMARK_NOINLINE static R forward(R (*next)(std::uint32_t), std::uint32_t input){
+            R result = next(input);
+            if(!result) return result;
+            return bump(*result);
+        }
+
+        static R level1(std::uint32_t input){ return forward(make, input); }
+        static R level2(std::uint32_t input){ return forward(level1, input); }
+
+        static std::uint64_t construct(std::uint32_t input){
+            return make(input).transform([](const P& payload){ return checksum(payload); }).value_or(0);
+        }
+
+        static std::uint64_t propagate(std::uint32_t input){
+            return forward(level2, input).transform([](const P& payload){ return checksum(payload); }).value_or(0);
+        }
+
+        static std::uint64_t map_chain(std::uint32_t input){
+            return make(input)
+                    .transform([](const P& payload){ return bump(payload); })
+                    .transform([](const P& payload){ return bump(payload); })
+                    .transform([](const P& payload){ return checksum(payload); })
+                    .value_or(0);
+        }
+    };
+
+#endif
+
+    template<std::size_t Bytes>
+    struct ErrorCodeStyle{
+        using P = Payload<Bytes>;
+
+        static constexpr const char* NAME = "error code";
+
+        BENCHMARK_NOINLINE static ErrorCode make(std::uint32_t input, P& out){
+            if(input < g_ErrorThreshold) return ErrorCode::Invalid;
+            out = make_payload<Bytes>(input);
+            return ErrorCode::None;
+        }
+
+        BENCHMARK_NOINLINE static ErrorCode forward(ErrorCode (*next)(std::uint32_t, P&), std::uint32_t input, P& out){
+            const ErrorCode code = next(input, out);
+            if(code != ErrorCode::None) return code;
+            out = bump(out);
+            return ErrorCode::None;
+        }
+
+        static ErrorCode level1(std::uint32_t input, P& out){ return forward(make, input, out); }
+        static ErrorCode level2(std::uint32_t input, P& out){ return forward(level1, input, out); }
+
+        static std::uint64_t construct(std::uint32_t input){
+            P payload;
+            return make(input, payload) == ErrorCode::None ? checksum(payload) : 0;
+        }
+
+        static std::uint64_t propagate(std::uint32_t input){
+            P payload;
+            return forward(level2, input, payload) == ErrorCode::None ? checksum(payload) : 0;
+        }
+
+        static std::uint64_t map_chain(std::uint32_t input){
+            P payload;
+            if(make(input, payload) != ErrorCode::None) return 0;
+            payload = bump(bump(payload));
+            return checksum(payload);
+        }
+    };
+
+    /**
+     * Runs one operation over every input, best of a few repetitions
+     * @return ns per input
+     */
+    template<typename Operation>
+    double time_per_input(const std::vector<std::uint32_t>& inputs, Operation operation, std::uint64_t& sink){
+        double best = 0;
+        for(int repetition = 0; repetition < REPETITIONS; ++repetition){
+            const auto start = Clock::now();
+            std::uint64_t sum = 0;
+            for(std::uint32_t input : inputs){
+                sum += operation(input);
+            }
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+            const double perInput = static_cast<double>(elapsed) / static_cast<double>(inputs.size());
+            best = repetition == 0 ? perInput : std::min(best, perInput);
+            sink += sum;
+        }
+        return best;
+    }
+
+    template<template<std::size_t> class Style, std::size_t Bytes>
+    void report_style(const std::vector<std::uint32_t>& inputs, std::uint64_t& sink){
+        using S = Style<Bytes>;
+        std::printf("    %-12s construct %7.2f   propagate %7.2f   map chain %7.2f  ns/op\n", S::NAME,
+                    time_per_input(inputs, S::construct, sink),
+                    time_per_input(inputs, S::propagate, sink),
+                    time_per_input(inputs, S::map_chain, sink));
+    }
+
+    template<std::size_t Bytes>
+    void report_payload(const std::vector<std::uint32_t>& inputs, std::uint64_t& sink){
+        std::printf("  %zu byte payload, sizeof Result %zu, optional %zu\n", Bytes,
+                    sizeof(Result<Payload<Bytes>, ErrorCode>), sizeof(std::optional<Payload<Bytes>>));
+        report_style<ResultStyle, Bytes>(inputs, sink);
+        report_style<OptionalStyle, Bytes>(inputs, sink);
+#if defined(MKTL_BENCHMARK_EXPECTED)
+        report_style<ExpectedStyle, Bytes>(inputs, sink);
+#endif
+        report_style<ErrorCodeStyle, Bytes>(inputs, sink);
+    }
+
+}
+
+int main(){
+    std::mt19937 random(42);
+    std::uniform_int_distribution<std::uint32_t> distribution(0, 999);
+    std::vector<std::uint32_t> inputs(INPUT_COUNT);
+    for(std::uint32_t& input : inputs){
+        input = distribution(random);
+    }
+
+#if !defined(MKTL_BENCHMARK_EXPECTED)
+    std::printf("std::expected is not available in this standard library, skipping it\n");
+#endif
+
+    std::uint64_t sink = 0;
+    const std::uint32_t errorRates[] = {0, 10, 500};
+    for(std::uint32_t errorRate : errorRates){
+        g_ErrorThreshold = errorRate;
+        std::printf("\n%.1f%% errors\n", static_cast<double>(errorRate) / 10.0);
+        report_payload<8>(inputs, sink);
+        report_payload<64>(inputs, sink);
+        report_payload<256>(inputs, sink);
+    }
+
+    // keeps every sum alive
+    std::printf("\nchecksum %llu\n", static_cast<unsigned long long>(sink));
+    return 0;
+}
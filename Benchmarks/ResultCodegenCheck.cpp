@@ -0,0 +1,177 @@
+// File: ResultCodegenCheck.cpp
+// Description: Catches changes that make Result more expensive than it should be. The static_asserts fail the build
+//                  if a Result of small trivial types stops fitting in registers or stops being trivially copyable,
+//                  and running it checks that the Ok path of common Result code neither allocates nor writes to the
+//                  standard streams. Exits with a failure code if it does.
+// Author: Matthew Krueger <mckrueg@bgsu.edu>
+
+#include <mktl/Result.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+#if defined(__GNUC__) || defined(__clang__)
+#   define CHECK_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#   define CHECK_NOINLINE __declspec(noinline)
+#else
+#   define CHECK_NOINLINE
+#endif
+
+using namespace mckrueg::stl;
+
+namespace{
+
+    enum class ErrorCode : std::uint8_t{
+        Invalid,
+        Overflow
+    };
+
+    struct Small{
+        std::int32_t x;
+        std::int32_t y;
+    };
+
+    struct Large{
+        std::uint64_t words[8];
+    };
+
+    ///////////////////////////////////////////////////
+    //  Layout. Result must cost no more than its   //
+    //  variant, and stay trivially copyable so the //
+    //  ABI can return it in registers.             //
+    ///////////////////////////////////////////////////
+
+    template<typename Ok, typename Err>
+    constexpr bool is_register_sized_v = sizeof(Result<Ok, Err>) <= 2 * sizeof(void*);
+
+    static_assert(sizeof(Result<int, ErrorCode>) == sizeof(std::variant<int, ErrorCode>), "Result adds no space over its variant");
+    static_assert(sizeof(Result<Large, ErrorCode>) == sizeof(std::variant<Large, ErrorCode>), "Result adds no space over its variant");
+
+    static_assert(is_register_sized_v<int, ErrorCode>, "Result<int, ErrorCode> should fit in two registers");
+    static_assert(is_register_sized_v<Small, ErrorCode>, "Result<Small, ErrorCode> should fit in two registers");
+    static_assert(is_register_sized_v<void*, ErrorCode>, "Result<void*, ErrorCode> should fit in two registers");
+
+    static_assert(std::is_trivially_copyable_v<Result<int, ErrorCode>>, "Result of trivial types must be trivially copyable");
+    static_assert(std::is_trivially_copyable_v<Result<Small, ErrorCode>>, "Result of trivial types must be trivially copyable");
+    static_assert(std::is_trivially_copyable_v<Result<Large, ErrorCode>>, "Result of trivial types must be trivially copyable");
+    static_assert(std::is_trivially_destructible_v<Result<Large, ErrorCode>>, "Result of trivial types must be trivially destructible");
+
+    static_assert(std::is_nothrow_move_constructible_v<Result<std::string, Error>>, "Moving a Result must not throw");
+
+    ///////////////////////////////////////////////////
+    //  Counting hooks for the success path checks  //
+    ///////////////////////////////////////////////////
+
+    std::size_t g_Allocations = 0;
+
+    /**
+     * Counts whatever is written through a standard stream while it is installed
+     */
+    class CountingBuffer : public std::streambuf{
+    public:
+        std::size_t written = 0;
+
+    protected:
+        int_type overflow(int_type character) override { ++written; return traits_type::not_eof(character); }
+        std::streamsize xsputn(const char*, std::streamsize count) override { written += static_cast<std::size_t>(count); return count; }
+    };
+
+    ///////////////////////////////////////////////////
+    //  Representative functions, kept out of line  //
+    ///////////////////////////////////////////////////
+
+    CHECK_NOINLINE Result<Small, ErrorCode> make_small(std::int32_t x){
+        if(x < 0) return Result<Small, ErrorCode>(ErrorCode::Invalid);
+        return Result<Small, ErrorCode>(Small{x, x + 1});
+    }
+
+    CHECK_NOINLINE Result<Small, ErrorCode> propagate_small(std::int32_t x){
+        auto result = make_small(x);
+        if(result.is_err()) return result;
+        Small value = result.unwrap();
+        value.y += 1;
+        return Result<Small, ErrorCode>(value);
+    }
+
+    CHECK_NOINLINE Result<std::int64_t, ErrorCode> map_chain(std::int32_t x){
+        return propagate_small(x)
+                .map<Small>([](const Small& value){ return Small{value.x * 2, value.y}; })
+                .map<std::int64_t>([](const Small& value){ return static_cast<std::int64_t>(value.x) + value.y; });
+    }
+
+    CHECK_NOINLINE Result<Large, ErrorCode> make_large(std::uint64_t seed){
+        if(seed == 0) return Result<Large, ErrorCode>(ErrorCode::Overflow);
+        Large value{};
+        for(std::uint64_t& word : value.words){
+            word = seed++;
+        }
+        return Result<Large, ErrorCode>(value);
+    }
+
+    CHECK_NOINLINE std::uint64_t consume_large(std::uint64_t seed){
+        const auto result = make_large(seed);
+        const auto ok = result.ok();
+        return result.unwrap().words[7] + result.unwrap_or(Large{}).words[0] + (ok ? ok->words[1] : 0);
+    }
+
+    int g_Failures = 0;
+
+    void check(bool condition, const char* what){
+        if(!condition){
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            ++g_Failures;
+        }
+    }
+
+}
+
+// Replaced for this executable only, it does not link the tracked operators from MKTL_Main
+void* operator new(std::size_t bytes){
+    ++g_Allocations;
+    if(void* pMemory = std::malloc(bytes ? bytes : 1)) return pMemory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pMemory) noexcept { std::free(pMemory); }
+void operator delete(void* pMemory, std::size_t) noexcept { std::free(pMemory); }
+
+int main(){
+    CountingBuffer streamCounter;
+    std::streambuf* pOut = std::cout.rdbuf(&streamCounter);
+    std::streambuf* pErr = std::cerr.rdbuf(&streamCounter);
+    std::streambuf* pLog = std::clog.rdbuf(&streamCounter);
+    const std::size_t allocationsBefore = g_Allocations;
+
+    std::int64_t sum = 0;
+    for(std::int32_t i = 1; i <= 1000; ++i){
+        sum += propagate_small(i).unwrap().y;
+        sum += map_chain(i).unwrap();
+        sum += static_cast<std::int64_t>(consume_large(static_cast<std::uint64_t>(i)));
+        sum += make_small(-i).is_err() ? 1 : 0;
+    }
+
+    const std::size_t allocations = g_Allocations - allocationsBefore;
+    std::cout.rdbuf(pOut);
+    std::cerr.rdbuf(pErr);
+    std::clog.rdbuf(pLog);
+
+    check(allocations == 0, "the Ok path of Result allocated on the heap");
+    check(streamCounter.written == 0, "the Ok path of Result wrote to a standard stream");
+    check(sum != 0, "the representative functions computed nothing");
+
+    if(g_Failures){
+        return EXIT_FAILURE;
+    }
+
+    std::printf("Result codegen checks passed (checksum %lld)\n", static_cast<long long>(sum));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+// File: SmallContainerCheck.cpp
+// Description: Regression checks for SmallVector and SmallString growing while the value being added points into the
+//                  container itself. Run it under AddressSanitizer to catch a read of the freed buffer, without it the
+//                  contents are still compared. Exits with a failure code if anything is wrong.
+// Author: Matthew Krueger <mckrueg@bgsu.edu>
+
+#include <mktl/SmallString.hpp>
+#include <mktl/SmallVector.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+using namespace mckrueg::stl;
+
+namespace{
+
+    int g_Failures = 0;
+
+    void check(bool condition, const char* what){
+        if(!condition){
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            ++g_Failures;
+        }
+    }
+
+    void check_vector_self_push_back(){
+        SmallVector<std::string, 2> strings;
+        strings.push_back("a long enough string to live on the heap");
+        strings.push_back("second");
+
+        // full, so this grows while the argument is still in the old buffer
+        strings.push_back(strings[0]);
+        check(strings.size() == 3 && strings[2] == strings[0], "SmallVector push_back of its own element while growing");
+
+        strings.resize(16, strings[1]);
+        check(strings.size() == 16 && strings[15] == "second", "SmallVector resize with its own element while growing");
+    }
+
+    void check_string_self_append(){
+        SmallString<8> text("abcd");
+
+        // inline to heap
+        text += std::string_view(text);
+        check(text == "abcdabcd", "SmallString self append within the inline storage");
+
+        text += std::string_view(text);
+        check(!text.is_inline() && text == "abcdabcdabcdabcd", "SmallString self append that spills");
+
+        // heap to a bigger heap buffer, the old one is freed
+        text.append(std::string_view(text).substr(4));
+        check(text == "abcdabcdabcdabcdabcdabcdabcd", "SmallString self append that regrows");
+
+        text.append(std::string_view(text).substr(text.size()));
+        check(text.size() == 28, "SmallString append of an empty view at its end");
+    }
+
+}
+
+int main(){
+    check_vector_self_push_back();
+    check_string_self_append();
+
+    if(g_Failures){
+        return EXIT_FAILURE;
+    }
+
+    std::printf("Small container checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+// File: ThreadPoolBenchmark.cpp
+// Description: Measures what spawning a task costs on the work stealing pool, and what it costs to free an arena
+//                  block from a thread other than the one that owns it.
+// Author: Matthew Krueger <mckrueg@bgsu.edu>
+
+#include <mktl/ThreadPool.hpp>
+#include <mktl_c/Memory.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace mckrueg::stl;
+
+namespace{
+
+    using Clock = std::chrono::steady_clock;
+
+    double nanoseconds_per(Clock::duration elapsed, std::size_t count){
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())
+               / static_cast<double>(count);
+    }
+
+    void report(const char* name, Clock::duration elapsed, std::size_t count){
+        std::printf("%-44s %10.1f ns/op   (%zu ops)\n", name, nanoseconds_per(elapsed, count), count);
+    }
+
+    void wait_for(const std::atomic<std::size_t>& counter, std::size_t target){
+        while(counter.load(std::memory_order_acquire) < target){
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * Tasks pushed from outside the pool, through the injection queue and operator new
+     */
+    void bench_external_spawn(ThreadPool& pool, std::size_t count){
+        std::atomic<std::size_t> done{0};
+
+        const auto start = Clock::now();
+        for(std::size_t i = 0; i < count; ++i){
+            pool.execute([&done]{ done.fetch_add(1, std::memory_order_release); });
+        }
+        wait_for(done, count);
+        report("spawn from outside the pool", Clock::now() - start, count);
+    }
+
+    /**
+     * Tasks pushed by a worker onto its own deque, allocated from its arena
+     */
+    void bench_worker_spawn(ThreadPool& pool, std::size_t count){
+        std::atomic<std::size_t> done{0};
+
+        const auto start = Clock::now();
+        pool.execute([&pool, &done, count]{
+            for(std::size_t i = 0; i < count; ++i){
+                pool.execute([&done]{ done.fetch_add(1, std::memory_order_release); });
+            }
+        });
+        wait_for(done, count);
+        report("spawn from a worker", Clock::now() - start, count);
+    }
+
+    /**
+     * Round trip through spawn, a Result carrying future, and get
+     */
+    void bench_future_round_trip(ThreadPool& pool, std::size_t count){
+        const auto start = Clock::now();
+        long long sum = 0;
+        for(std::size_t i = 0; i < count; ++i){
+            auto future = pool.spawn([i]() -> Result<long long, Error> { return static_cast<long long>(i); });
+            sum += future.get().unwrap_or(0);
+        }
+        report("spawn + get of a Result future", Clock::now() - start, count);
+
+        if(sum != static_cast<long long>(count) * static_cast<long long>(count - 1) / 2){
+            std::fprintf(stderr, "Future round trip produced the wrong sum\n");
+            std::exit(1);
+        }
+    }
+
+    /**
+     * One thread owns an arena and allocates, another frees everything it allocated
+     */
+    void bench_cross_thread_free(std::size_t count){
+        WorkerArena arena;
+        std::vector<void*> blocks(count);
+
+        std::thread owner([&]{
+            WorkerArena::bind(&arena);
+            for(void*& pBlock : blocks){
+                pBlock = WorkerArena::allocate(48);
+            }
+            WorkerArena::bind(nullptr);
+        });
+        owner.join();
+
+        const ArenaStats before = getArenaStats();
+        const auto start = Clock::now();
+        std::thread freer([&]{
+            for(void* pBlock : blocks){
+                WorkerArena::deallocate(pBlock);
+            }
+        });
+        freer.join();
+        report("cross thread free of an arena block", Clock::now() - start, count);
+
+        // The owner takes the remote frees back before carving new memory
+        const auto reclaimStart = Clock::now();
+        std::thread reclaimer([&]{
+            WorkerArena::bind(&arena);
+            for(void*& pBlock : blocks){
+                pBlock = WorkerArena::allocate(48);
+            }
+            for(void* pBlock : blocks){
+                WorkerArena::deallocate(pBlock);
+            }
+            WorkerArena::bind(nullptr);
+        });
+        reclaimer.join();
+        report("owner reallocate + free after remote frees", Clock::now() - reclaimStart, count);
+
+        const ArenaStats after = getArenaStats();
+        std::printf("%-44s %10llu\n", "remote frees recorded",
+                    after.remoteDeallocationCount - before.remoteDeallocationCount);
+    }
+
+}
+
+int main(int argc, char** argv){
+    const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    {
+        ThreadPool pool;
+        std::printf("MKTL thread pool benchmark, %zu workers\n\n", pool.worker_count());
+
+        bench_external_spawn(pool, count);
+        bench_worker_spawn(pool, count);
+        bench_future_round_trip(pool, count / 10);
+    }
+
+    bench_cross_thread_free(count);
+
+    const ArenaStats stats = getArenaStats();
+    std::printf("\nArena totals: %llu allocations, %llu local frees, %llu remote frees, %llu bytes still reserved\n",
+                stats.allocationCount, stats.deallocationCount, stats.remoteDeallocationCount, stats.bytesReserved);
+    return 0;
+}
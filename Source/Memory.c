@@ -6,44 +6,103 @@
 
 #include <mktl_c/Memory.h>
 #include <stdio.h>
-
-struct Node {
+#include <string.h>
+
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <pthread.h>
+#endif
+
+// The tracker is an open addressing table in the same layout as mckrueg::stl::FlatHashMap, kept in C so it can sit
+// under the C++ allocation operators. Each slot has a control byte holding either EMPTY or 7 bits of its pointer's hash,
+// and a lookup scans one group of control bytes before it compares any pointers. Entries are never removed, a freed
+// pointer stays in the table as DEALLOCATED until the address is handed out again.
+//
+// The thread pool arenas and the lock free queues allocate from every worker, and growing the table frees the old
+// arrays, so the table and the counters are only touched while holding tableLock.
+#define MEMORY_SAN_GROUP_WIDTH 16
+#define MEMORY_SAN_CONTROL_EMPTY 0x80
+#define MEMORY_SAN_INITIAL_CAPACITY 256
+
+struct Slot {
     void* ptr;
     struct PointerInfo structPointerInfo;
-    struct Node* next;
-} ;
+};
 
 __MKTL_API_HIDDEN static char registeredFlag = 0;
-__MKTL_API_HIDDEN static struct Node* memoryInfo = NULL;
+__MKTL_API_HIDDEN static unsigned char* controlBytes = NULL;
+__MKTL_API_HIDDEN static struct Slot* slots = NULL;
+__MKTL_API_HIDDEN static size_t slotCapacity = 0;
+__MKTL_API_HIDDEN static size_t slotCount = 0;
 __MKTL_API_HIDDEN static unsigned long long bytesAllocated = 0;
 __MKTL_API_HIDDEN static unsigned long long allocationCount = 0;
 __MKTL_API_HIDDEN static unsigned long long bytesDeallocated = 0;
 __MKTL_API_HIDDEN static unsigned long long deallocationCount = 0;
 
+#if defined(_WIN32)
+__MKTL_API_HIDDEN static SRWLOCK tableLock = SRWLOCK_INIT;
+#else
+__MKTL_API_HIDDEN static pthread_mutex_t tableLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/**
+ * Take the lock guarding the table and the counters. Not recursive, the internal functions below expect it held.
+ */
+static void memorySanLock(){
+#if defined(_WIN32)
+    AcquireSRWLockExclusive(&tableLock);
+#else
+    pthread_mutex_lock(&tableLock);
+#endif
+}
+
+/**
+ * Release the lock guarding the table and the counters
+ */
+static void memorySanUnlock(){
+#if defined(_WIN32)
+    ReleaseSRWLockExclusive(&tableLock);
+#else
+    pthread_mutex_unlock(&tableLock);
+#endif
+}
+
 __MKTL_API_HIDDEN void memorySanAtExitHook(){
 
-    // clear linked list, and print if there's an issue
-    while(memoryInfo){
-        struct Node* temp = memoryInfo;
-        memoryInfo = temp->next;
+    size_t i;
+
+    memorySanLock();
+
+    // print if there's an issue, then drop the table
+    for(i = 0; i < slotCapacity; ++i){
+        struct Slot* slot = &slots[i];
+        if(controlBytes[i] == MEMORY_SAN_CONTROL_EMPTY) continue;
 
         // if pointer is invalid or allocated, there's a memory issue and we should alert to this condition
-        if(temp->structPointerInfo.enumPointerState == INVALID){
-            fprintf(stderr, "Pointer %p of size %lu is in an invalid state at application close.\n", temp->ptr, temp->structPointerInfo.pointerSize);
+        if(slot->structPointerInfo.enumPointerState == INVALID){
+            fprintf(stderr, "Pointer %p of size %lu is in an invalid state at application close.\n", slot->ptr, slot->structPointerInfo.pointerSize);
         }
-        if(temp->structPointerInfo.enumPointerState == ALLOCATED){
-            fprintf(stderr, "Pointer %p of size %lu is still in allocated state at application close.\n", temp->ptr, temp->structPointerInfo.pointerSize);
+        if(slot->structPointerInfo.enumPointerState == ALLOCATED){
+            fprintf(stderr, "Pointer %p of size %lu is still in allocated state at application close.\n", slot->ptr, slot->structPointerInfo.pointerSize);
         }
-
-        // it is not the job of this function to deallocate the pointers. We're just going to delete our reference since
-        // this function should only be called at exit
-        free(temp);
     }
 
+    // it is not the job of this function to deallocate the pointers. We're just going to delete our table since
+    // this function should only be called at exit
+    free(controlBytes);
+    free(slots);
+    controlBytes = NULL;
+    slots = NULL;
+    slotCapacity = 0;
+    slotCount = 0;
+
+    memorySanUnlock();
+
 }
 
 /**
- * Registers a callback at exit on the first call (otherwise nothing) to clear the linked list
+ * Registers a callback at exit on the first call (otherwise nothing) to clear the table. The caller holds tableLock.
  */
 __MKTL_API_HIDDEN void memorySanRegisterSystem(){
     if(registeredFlag) return;
@@ -52,111 +111,177 @@ __MKTL_API_HIDDEN void memorySanRegisterSystem(){
 }
 
 /**
- * Adds a node to the linked list
- * @param head the head pointer (just in case you have multiple pAllocator)
- * @param ptr the pointer to add
- * @param structPointerInfo The Info about the pointer
+ * Hashes a pointer. Allocations are aligned, so the low bits carry nothing and have to be mixed with the high ones.
+ * @param ptr the pointer to hash
+ * @return the hash
  */
-__MKTL_API_HIDDEN void memorySanAddNode(struct Node** head, void* ptr, struct PointerInfo structPointerInfo){
-
-    struct Node* newNode = malloc(sizeof(struct Node));
-    if(!newNode){
-        fprintf(stderr, "Cannot allocate new node to track memory allocations.\n");
-        return;
-    }
+static size_t memorySanHash(void* ptr){
+    size_t hash = (size_t) ptr;
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6DUL;
+    hash ^= hash >> 12;
+    hash *= 0x297A2D39UL;
+    hash ^= hash >> 15;
+    return hash;
+}
 
-    newNode->ptr = ptr;
-    newNode->structPointerInfo = structPointerInfo;
-    newNode->next = *head;
-    *head = newNode;
+/**
+ * The 7 bits of the hash stored in the control byte. Taken from the top, the bottom picks the group.
+ * @param hash the pointer's hash
+ * @return the control byte for a full slot
+ */
+static unsigned char memorySanTag(size_t hash){
+    return (unsigned char) ((hash >> (sizeof(size_t) * 8 - 7)) & 0x7F);
 }
 
 /**
- * Find according to linus torvalds talk about good code taste
- * @param head the head pointer
+ * Find the slot holding a pointer. Groups are probed quadratically and the search stops at the first group that has
+ * an empty slot, since an insert would have used it.
  * @param ptr the pointer to find the data about
- * @return the indirect pointer to the node that is about the given pointer
+ * @return the slot that is about the given pointer, or NULL
  */
-__MKTL_API_HIDDEN struct Node** memorySanFindIndirect(struct Node** head, void* ptr){
+static struct Slot* memorySanFindSlot(void* ptr){
+
+    size_t hash, groupMask, group, probe, i;
+    unsigned char tag;
 
     if(!ptr){
-        fprintf(stderr, "Cannot find pointer in memory allocation tracking list, as no pointer was given.\n");
+        fprintf(stderr, "Cannot find pointer in memory allocation tracking table, as no pointer was given.\n");
         return NULL;
     }
 
-    if(!head){
-        fprintf(stderr, "Cannot find pointer in memory allocation tracking list, as list is empty.\n");
-        return NULL;
-    }
+    if(!slotCapacity) return NULL;
 
-    struct Node** indirect = &(*head);
-    while(indirect && (*indirect) && (*indirect)->ptr != ptr){
-        indirect = &(*indirect)->next;
+    hash = memorySanHash(ptr);
+    tag = memorySanTag(hash);
+    groupMask = slotCapacity / MEMORY_SAN_GROUP_WIDTH - 1;
+    group = hash & groupMask;
+
+    for(probe = 1; probe <= groupMask + 1; ++probe){
+        size_t base = group * MEMORY_SAN_GROUP_WIDTH;
+        char sawEmpty = 0;
+
+        for(i = base; i < base + MEMORY_SAN_GROUP_WIDTH; ++i){
+            if(controlBytes[i] == tag && slots[i].ptr == ptr) return &slots[i];
+            if(controlBytes[i] == MEMORY_SAN_CONTROL_EMPTY) sawEmpty = 1;
+        }
+
+        if(sawEmpty) return NULL;
+        group = (group + probe) & groupMask;
     }
 
-    return indirect;
+    return NULL;
 
 }
 
 /**
- * Remove a node from the list.
- * @param head The head pointer
- * @param ptr The pointer *about which* to remove the data
+ * Claim an empty slot for a pointer known not to be in the table. There is always one, the table is never more than
+ * 7/8 full.
+ * @param hash the pointer's hash
+ * @return the index of the claimed slot
  */
-__MKTL_API_HIDDEN void memorySanRemoveNode(struct Node** head, void* ptr){
-
-    if(!ptr){
-        fprintf(stderr, "Cannot remove pointer from memory allocation tracking list, as no pointer was given.\n");
-        return;
+static size_t memorySanClaimSlot(size_t hash){
+
+    size_t groupMask = slotCapacity / MEMORY_SAN_GROUP_WIDTH - 1;
+    size_t group = hash & groupMask;
+    size_t probe, i;
+
+    for(probe = 1; ; ++probe){
+        size_t base = group * MEMORY_SAN_GROUP_WIDTH;
+        for(i = base; i < base + MEMORY_SAN_GROUP_WIDTH; ++i){
+            if(controlBytes[i] == MEMORY_SAN_CONTROL_EMPTY){
+                controlBytes[i] = memorySanTag(hash);
+                return i;
+            }
+        }
+        group = (group + probe) & groupMask;
     }
 
-    if(!head){
-        fprintf(stderr, "Cannot remove pointer from memory allocation tracking list, as list is empty.\n");
-        return;
+}
+
+/**
+ * Move every slot into a table twice the size.
+ * @return 0 if the new table could not be allocated, in which case the old one is kept
+ */
+static char memorySanGrow(){
+
+    size_t newCapacity = slotCapacity ? slotCapacity * 2 : MEMORY_SAN_INITIAL_CAPACITY;
+    unsigned char* oldControlBytes = controlBytes;
+    struct Slot* oldSlots = slots;
+    size_t oldCapacity = slotCapacity;
+    unsigned char* newControlBytes = malloc(newCapacity);
+    struct Slot* newSlots = malloc(newCapacity * sizeof(struct Slot));
+    size_t i;
+
+    if(!newControlBytes || !newSlots){
+        free(newControlBytes);
+        free(newSlots);
+        return 0;
     }
 
-    struct Node** indirect = memorySanFindIndirect(head, ptr);
+    memset(newControlBytes, MEMORY_SAN_CONTROL_EMPTY, newCapacity);
+    controlBytes = newControlBytes;
+    slots = newSlots;
+    slotCapacity = newCapacity;
 
-    // If the node was not found
-    if (!indirect || !*indirect) {
-        fprintf(stderr, "Node to delete not found or invalid.\n");
-        return;
+    for(i = 0; i < oldCapacity; ++i){
+        if(oldControlBytes[i] == MEMORY_SAN_CONTROL_EMPTY) continue;
+        slots[memorySanClaimSlot(memorySanHash(oldSlots[i].ptr))] = oldSlots[i];
     }
 
+    free(oldControlBytes);
+    free(oldSlots);
+    return 1;
 
-    // We have a valid node to delete
-    struct Node* node_to_delete = *indirect;
+}
 
-    // Relink the list: bypass the node to delete
-    *indirect = node_to_delete->next;
+/**
+ * Record a pointer, replacing what is known about it if the address was tracked before. The caller holds tableLock.
+ * @param ptr the pointer to add
+ * @param structPointerInfo The Info about the pointer
+ */
+__MKTL_API_HIDDEN void memorySanAddPointer(void* ptr, struct PointerInfo structPointerInfo){
+
+    struct Slot* slot;
+    size_t index;
+
+    if(!ptr) return; // a failed allocation, nothing to track
 
-    // Free the memory associated with the node
-    free(node_to_delete);
+    slot = memorySanFindSlot(ptr);
+    if(slot){
+        slot->structPointerInfo = structPointerInfo;
+        return;
+    }
+
+    if(slotCount + 1 > slotCapacity - slotCapacity / 8 && !memorySanGrow()){
+        fprintf(stderr, "Cannot grow table to track memory allocations.\n");
+        return;
+    }
+
+    index = memorySanClaimSlot(memorySanHash(ptr));
+    slots[index].ptr = ptr;
+    slots[index].structPointerInfo = structPointerInfo;
+    ++slotCount;
 
 }
 
 /**
  * Get the pointer info. This should not be called publicly since it does NOT copy and instead returns our internal
- * memory from our data structure.
+ * memory from our data structure, which is only valid while the caller holds tableLock.
  * @param pVoid The pointer about which to find.
  * @return
  */
 __MKTL_API_HIDDEN struct PointerInfo* memorySanGetPointerInfoInternal(void *pVoid){
 
-    struct Node** indirect = memorySanFindIndirect(&memoryInfo, pVoid);
-    if(!indirect) return NULL; // guard
+    struct Slot* slot = memorySanFindSlot(pVoid);
+    if(!slot) return NULL; // guard
 
-    struct Node* structNode = *indirect;
-    if(!structNode) return NULL; // guard
-
-    return &structNode->structPointerInfo;
+    return &slot->structPointerInfo;
 
 }
 
 void *trackedMalloc(unsigned long bytes){
 
-    memorySanRegisterSystem();
-
     // initialize the tracking struct
     struct PointerInfo structPointerInfo;
     structPointerInfo.enumPointerState = INVALID;
@@ -166,10 +291,13 @@ void *trackedMalloc(unsigned long bytes){
     void* trackedPtr = malloc(bytes);
     structPointerInfo.enumPointerState = ALLOCATED;
 
+    memorySanLock();
+    memorySanRegisterSystem();
     ++allocationCount;
     bytesAllocated+=bytes;
 
-    memorySanAddNode(&memoryInfo, trackedPtr, structPointerInfo);
+    memorySanAddPointer(trackedPtr, structPointerInfo);
+    memorySanUnlock();
 
     return trackedPtr;
 
@@ -177,46 +305,75 @@ void *trackedMalloc(unsigned long bytes){
 
 void trackedFree(void *pVoid){
 
-    struct PointerInfo* pStructPointerInfo = memorySanGetPointerInfoInternal(pVoid);
+    struct PointerInfo* pStructPointerInfo;
+
+    // marked before the real free, so the address cannot be handed out again and re-added while this still holds it
+    memorySanLock();
+    pStructPointerInfo = memorySanGetPointerInfoInternal(pVoid);
     if(pStructPointerInfo){
         pStructPointerInfo->enumPointerState = DEALLOCATED;
         ++deallocationCount;
         bytesDeallocated += pStructPointerInfo->pointerSize;
     }
+    memorySanUnlock();
 
     free(pVoid);
 
 }
 
 struct PointerInfo getPointerInfo(void *pVoid){
-    struct PointerInfo* pStructPointerInfo = memorySanGetPointerInfoInternal(pVoid);
+    struct PointerInfo structPointerInfo;
+    struct PointerInfo* pStructPointerInfo;
+
+    memorySanLock();
+    pStructPointerInfo = memorySanGetPointerInfoInternal(pVoid);
+    if(pStructPointerInfo){
+        structPointerInfo = *pStructPointerInfo;
+    }
+    memorySanUnlock();
+
     if(!pStructPointerInfo){
         fprintf(stderr, "Attempting to get pointer info of non-tracked pointer\n");
-        struct PointerInfo structPointerInfo;
         structPointerInfo.enumPointerState = INVALID;
         structPointerInfo.pointerSize = 0;
-        return structPointerInfo;
     }
 
-    return *pStructPointerInfo;
+    return structPointerInfo;
+}
+
+/**
+ * Read one of the counters under the lock, a 64 bit read is not atomic on every target
+ * @param pCounter the counter to read
+ * @return its value
+ */
+static unsigned long long memorySanReadCounter(const unsigned long long* pCounter){
+    unsigned long long value;
+    memorySanLock();
+    value = *pCounter;
+    memorySanUnlock();
+    return value;
 }
 
 unsigned long long getTotalBytesAllocated(){
-    return bytesAllocated;
+    return memorySanReadCounter(&bytesAllocated);
 }
 
 unsigned long long getAllocationCount(){
-    return allocationCount;
+    return memorySanReadCounter(&allocationCount);
 }
 
 unsigned long long getTotalBytesDeallocated(){
-    return bytesDeallocated;
+    return memorySanReadCounter(&bytesDeallocated);
 }
 
 unsigned long long getDeallocationCount(){
-    return deallocationCount;
+    return memorySanReadCounter(&deallocationCount);
 }
 
 unsigned long long getBytesCurrentlyAllocated(){
-    return getTotalBytesAllocated() - getTotalBytesDeallocated();
+    unsigned long long value;
+    memorySanLock();
+    value = bytesAllocated - bytesDeallocated;
+    memorySanUnlock();
+    return value;
 }
@@ -7,6 +7,8 @@
 
 #include <mktl_c/Memory.h>
 
+#include <atomic>
+
 void* operator new(size_t bytes){
 #ifdef USE_MEMORY_TRACKING
     return trackedMalloc(bytes);
@@ -37,4 +39,38 @@ void operator delete[](void* pVoid) noexcept{
 #else
     return free(pVoid);
 #endif
-}
\ No newline at end of file
+}
+
+// The sized versions have to be replaced too, otherwise the standard library frees through them and skips the tracker
+void operator delete(void* pVoid, size_t) noexcept{
+    operator delete(pVoid);
+}
+
+void operator delete[](void* pVoid, size_t) noexcept{
+    operator delete[](pVoid);
+}
+
+// Small containers are used from any thread, so unlike the tracker these counters are atomic
+static std::atomic<unsigned long long> inlineSpillCount{0};
+static std::atomic<unsigned long long> inlineSpillBytes{0};
+static std::atomic<unsigned long long> inlineRegrowthCount{0};
+static std::atomic<unsigned long long> inlineRegrowthBytes{0};
+
+void recordInlineSpill(unsigned long bytes){
+    inlineSpillCount.fetch_add(1, std::memory_order_relaxed);
+    inlineSpillBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void recordInlineRegrowth(unsigned long bytes){
+    inlineRegrowthCount.fetch_add(1, std::memory_order_relaxed);
+    inlineRegrowthBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+struct InlineSpillStats getInlineSpillStats(){
+    struct InlineSpillStats stats;
+    stats.spillCount = inlineSpillCount.load(std::memory_order_relaxed);
+    stats.spillBytes = inlineSpillBytes.load(std::memory_order_relaxed);
+    stats.regrowthCount = inlineRegrowthCount.load(std::memory_order_relaxed);
+    stats.regrowthBytes = inlineRegrowthBytes.load(std::memory_order_relaxed);
+    return stats;
+}
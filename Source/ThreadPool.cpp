@@ -0,0 +1,323 @@
+// File: ThreadPool.cpp
+// Description: Work stealing thread pool and the per-worker arenas it allocates tasks from. The templated halves
+//                  live in mktl/ThreadPool.hpp.
+// Author: Matthew Krueger <mckrueg@bgsu.edu>
+
+#include <mktl/ThreadPool.hpp>
+#include <mktl_c/Memory.h>
+
+#include <algorithm>
+
+namespace mckrueg::stl{
+
+    /**
+     * Keeps track of every live arena, and of the counters of arenas that have since been destroyed, so that
+     * getArenaStats() can report totals for the whole process.
+     */
+    struct ArenaRegistry{
+        std::mutex mutex;
+        std::vector<WorkerArena*> arenas;
+        ArenaStats retired{};
+
+        static ArenaRegistry& get(){
+            static ArenaRegistry registry;
+            return registry;
+        }
+
+        static void add_counters(ArenaStats& stats, const WorkerArena& arena){
+            stats.bytesReserved += arena.m_BytesReserved.load(std::memory_order_relaxed);
+            stats.allocationCount += arena.m_AllocationCount.load(std::memory_order_relaxed);
+            stats.deallocationCount += arena.m_DeallocationCount.load(std::memory_order_relaxed);
+            stats.remoteDeallocationCount += arena.m_RemoteDeallocationCount.load(std::memory_order_relaxed);
+        }
+    };
+
+    namespace{
+
+        thread_local WorkerArena* t_pCurrentArena = nullptr;
+
+        // Which pool, if any, the calling thread works for
+        thread_local const ThreadPool* t_pCurrentPool = nullptr;
+        thread_local std::size_t t_WorkerIndex = 0;
+
+        // Spins through the deques this many times before a worker parks
+        constexpr int STEAL_ATTEMPTS_BEFORE_PARKING = 64;
+
+        inline std::size_t xorshift(std::size_t& state) noexcept {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+
+    }
+
+    //////////////////////////////////////////////////
+    //                  WorkerArena                 //
+    //////////////////////////////////////////////////
+
+    WorkerArena::WorkerArena(){
+        ArenaRegistry& registry = ArenaRegistry::get();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.arenas.push_back(this);
+    }
+
+    WorkerArena::~WorkerArena(){
+        {
+            ArenaRegistry& registry = ArenaRegistry::get();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.arenas.erase(std::find(registry.arenas.begin(), registry.arenas.end(), this));
+
+            ArenaRegistry::add_counters(registry.retired, *this);
+            registry.retired.bytesReserved -= m_BytesReserved.load(std::memory_order_relaxed);
+        }
+
+        for(void* pSlab : m_Slabs){
+            ::operator delete(pSlab);
+        }
+    }
+
+    void* WorkerArena::allocate(std::size_t bytes){
+        const std::size_t needed = bytes + sizeof(BlockHeader);
+
+        std::size_t sizeClass = 0;
+        while(sizeClass < SIZE_CLASS_COUNT && (SMALLEST_BLOCK << sizeClass) < needed){
+            ++sizeClass;
+        }
+
+        WorkerArena* pArena = t_pCurrentArena;
+        BlockHeader* pHeader;
+        if(pArena && sizeClass < SIZE_CLASS_COUNT){
+            pHeader = static_cast<BlockHeader*>(pArena->allocate_block(sizeClass));
+        }else{
+            pHeader = static_cast<BlockHeader*>(::operator new(needed));
+            pArena = nullptr;
+        }
+
+        pHeader->pOwner = pArena;
+        pHeader->sizeClass = sizeClass;
+        return pHeader + 1;
+    }
+
+    void WorkerArena::deallocate(void* pBlock) noexcept {
+        if(!pBlock) return;
+
+        BlockHeader* pHeader = static_cast<BlockHeader*>(pBlock) - 1;
+        WorkerArena* pOwner = pHeader->pOwner;
+
+        if(!pOwner){
+            ::operator delete(pHeader);
+            return;
+        }
+
+        if(pOwner == t_pCurrentArena){
+            pOwner->free_block(pHeader);
+            return;
+        }
+
+        // Cross thread free, hand the block back to its owner
+        auto* pFree = reinterpret_cast<FreeBlock*>(pHeader);
+        std::atomic<FreeBlock*>& remote = pOwner->m_RemoteFrees[pHeader->sizeClass];
+        pFree->next = remote.load(std::memory_order_relaxed);
+        while(!remote.compare_exchange_weak(pFree->next, pFree, std::memory_order_release, std::memory_order_relaxed)){
+        }
+        pOwner->m_RemoteDeallocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void WorkerArena::bind(WorkerArena* pArena) noexcept {
+        t_pCurrentArena = pArena;
+    }
+
+    WorkerArena* WorkerArena::current() noexcept {
+        return t_pCurrentArena;
+    }
+
+    void* WorkerArena::allocate_block(std::size_t sizeClass){
+        m_AllocationCount.store(m_AllocationCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        FreeBlock*& freeList = m_FreeLists[sizeClass];
+        if(!freeList){
+            // Only the owner pops, and it takes the whole list, so there is no ABA problem here
+            freeList = m_RemoteFrees[sizeClass].exchange(nullptr, std::memory_order_acquire);
+        }
+
+        if(freeList){
+            FreeBlock* pBlock = freeList;
+            freeList = pBlock->next;
+            return pBlock;
+        }
+
+        const std::size_t blockSize = SMALLEST_BLOCK << sizeClass;
+        if(static_cast<std::size_t>(m_pEnd - m_pCursor) < blockSize){
+            // The tail of the old slab is abandoned, it is at most one block of the largest class
+            m_Slabs.push_back(::operator new(SLAB_SIZE));
+            m_pCursor = static_cast<unsigned char*>(m_Slabs.back());
+            m_pEnd = m_pCursor + SLAB_SIZE;
+            m_BytesReserved.store(m_BytesReserved.load(std::memory_order_relaxed) + SLAB_SIZE, std::memory_order_relaxed);
+        }
+
+        void* pBlock = m_pCursor;
+        m_pCursor += blockSize;
+        return pBlock;
+    }
+
+    void WorkerArena::free_block(BlockHeader* pHeader) noexcept {
+        m_DeallocationCount.store(m_DeallocationCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        auto* pFree = reinterpret_cast<FreeBlock*>(pHeader);
+        FreeBlock*& freeList = m_FreeLists[pHeader->sizeClass];
+        pFree->next = freeList;
+        freeList = pFree;
+    }
+
+    //////////////////////////////////////////////////
+    //                  ThreadPool                  //
+    //////////////////////////////////////////////////
+
+    struct ThreadPool::Worker{
+        WorkStealingDeque<detail::Task*> deque;
+        WorkerArena arena;
+        std::thread thread;
+    };
+
+    ThreadPool::ThreadPool(std::size_t workerCount){
+        workerCount = std::max<std::size_t>(workerCount, 1);
+
+        m_Workers.reserve(workerCount);
+        for(std::size_t i = 0; i < workerCount; ++i){
+            m_Workers.push_back(std::make_unique<Worker>());
+        }
+
+        // Start only once every deque exists, as workers steal from each other straight away
+        for(std::size_t i = 0; i < workerCount; ++i){
+            m_Workers[i]->thread = std::thread([this, i]{ worker_main(i); });
+        }
+    }
+
+    ThreadPool::~ThreadPool(){
+        {
+            std::lock_guard<std::mutex> lock(m_ParkMutex);
+            m_Stopping.store(true, std::memory_order_seq_cst);
+        }
+        m_ParkCondition.notify_all();
+
+        for(std::unique_ptr<Worker>& pWorker : m_Workers){
+            pWorker->thread.join();
+        }
+    }
+
+    bool ThreadPool::is_worker_thread() const noexcept {
+        return t_pCurrentPool == this;
+    }
+
+    void ThreadPool::submit(detail::Task* pTask){
+        if(is_worker_thread()){
+            m_Workers[t_WorkerIndex]->deque.push(pTask);
+        }else{
+            std::lock_guard<std::mutex> lock(m_InjectionMutex);
+            m_Injected.push_back(pTask);
+        }
+
+        // Counting after the push means a worker that sees the count can also see the task. Sleepers is read after,
+        // pairing with the parking worker raising it before it re-checks the count, so one side always sees the other.
+        m_QueuedTasks.fetch_add(1, std::memory_order_seq_cst);
+        if(m_Sleepers.load(std::memory_order_seq_cst) > 0){
+            std::lock_guard<std::mutex> lock(m_ParkMutex);
+            m_ParkCondition.notify_one();
+        }
+    }
+
+    detail::Task* ThreadPool::find_task(std::size_t self){
+        detail::Task* pTask = nullptr;
+
+        if(m_Workers[self]->deque.pop(pTask)){
+            m_QueuedTasks.fetch_sub(1, std::memory_order_relaxed);
+            return pTask;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_InjectionMutex);
+            if(!m_Injected.empty()){
+                pTask = m_Injected.front();
+                m_Injected.pop_front();
+            }
+        }
+        if(pTask){
+            m_QueuedTasks.fetch_sub(1, std::memory_order_relaxed);
+            return pTask;
+        }
+
+        // Start at a random victim so thieves do not all pile onto worker 0
+        thread_local std::size_t seed = 0x9E3779B97F4A7C15ULL ^ (self + 1);
+        const std::size_t workerCount = m_Workers.size();
+        const std::size_t start = xorshift(seed) % workerCount;
+        for(std::size_t i = 0; i < workerCount; ++i){
+            const std::size_t victim = (start + i) % workerCount;
+            if(victim != self && m_Workers[victim]->deque.steal(pTask)){
+                m_QueuedTasks.fetch_sub(1, std::memory_order_relaxed);
+                return pTask;
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool ThreadPool::run_pending_task(){
+        if(!is_worker_thread()) return false;
+
+        detail::Task* pTask = find_task(t_WorkerIndex);
+        if(!pTask) return false;
+
+        pTask->pExecute(pTask);
+        return true;
+    }
+
+    void ThreadPool::worker_main(std::size_t self){
+        t_pCurrentPool = this;
+        t_WorkerIndex = self;
+        WorkerArena::bind(&m_Workers[self]->arena);
+
+        int failedAttempts = 0;
+        while(true){
+            if(detail::Task* pTask = find_task(self)){
+                pTask->pExecute(pTask);
+                failedAttempts = 0;
+                continue;
+            }
+
+            if(++failedAttempts < STEAL_ATTEMPTS_BEFORE_PARKING){
+                std::this_thread::yield();
+                continue;
+            }
+            failedAttempts = 0;
+
+            std::unique_lock<std::mutex> lock(m_ParkMutex);
+            m_Sleepers.fetch_add(1, std::memory_order_seq_cst);
+            m_ParkCondition.wait(lock, [this]{
+                return m_QueuedTasks.load(std::memory_order_seq_cst) > 0 || m_Stopping.load(std::memory_order_seq_cst);
+            });
+            m_Sleepers.fetch_sub(1, std::memory_order_seq_cst);
+
+            if(m_Stopping.load(std::memory_order_seq_cst) && m_QueuedTasks.load(std::memory_order_seq_cst) == 0){
+                break;
+            }
+        }
+
+        WorkerArena::bind(nullptr);
+        t_pCurrentPool = nullptr;
+    }
+
+}
+
+struct ArenaStats getArenaStats(){
+    using mckrueg::stl::ArenaRegistry;
+
+    ArenaRegistry& registry = ArenaRegistry::get();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    ArenaStats stats = registry.retired;
+    for(const mckrueg::stl::WorkerArena* pArena : registry.arenas){
+        ArenaRegistry::add_counters(stats, *pArena);
+    }
+    return stats;
+}
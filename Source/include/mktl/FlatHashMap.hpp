@@ -0,0 +1,915 @@
+/********************************************************************************
+ *  MCKRUEG STL - mckrueg's standard template library of C++ useful stuff       *
+ *  Copyright (C) 2024 Matthew Krueger <contact@matthewkrueger.com>             *
+ *                                                                              *
+ *  This program is free software: you can redistribute it and/or modify        *
+ *  it under the terms of the GNU General Public License as published by        *
+ *  the Free Software Foundation, either version 3 of the License, or           *
+ *  (at your option) any later version.                                         *
+ *                                                                              *
+ *  This program is distributed in the hope that it will be useful,             *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ *  GNU General Public License for more details.                                *
+ *                                                                              *
+ *  You should have received a copy of the GNU General Public License           *
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+ ********************************************************************************/
+
+/*************************************
+ * The mckrueg stl requires
+ * C++ 17
+ *************************************/
+
+#if __cplusplus < 201703L
+# error MCKRUEG STL requires the use of C++ 17
+#endif
+
+#ifndef MKTL_FLAT_HASH_MAP_HPP
+#define MKTL_FLAT_HASH_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+#include "Result.hpp"
+#include "SmallVector.hpp"
+#include "Traps.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define MKTL_FLAT_HASH_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#   include <arm_neon.h>
+#   define MKTL_FLAT_HASH_NEON 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#   include <intrin.h>
+#endif
+
+namespace mckrueg::stl{
+
+    /**
+     * \brief Why a Result returning hash map operation did not go through
+     */
+    enum class HashMapError{
+        NotFound,
+        KeyExists
+    };
+
+    inline std::ostream& operator<<(std::ostream& os, HashMapError error){
+        return os << (error == HashMapError::NotFound ? "Key not found" : "Key already exists");
+    }
+
+    namespace detail{
+
+        // Control byte values. A full slot stores the low 7 bits of its hash, so it is never negative.
+        constexpr std::int8_t CONTROL_EMPTY = -128;
+        constexpr std::int8_t CONTROL_DELETED = -2;
+        constexpr std::size_t GROUP_WIDTH = 16;
+
+        inline unsigned count_trailing_zeros(std::uint64_t value) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward64(&index, value);
+            return static_cast<unsigned>(index);
+#else
+            return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+        }
+
+        /**
+         * \brief One bit per matching slot of a group. Iterating yields slot indices within the group.
+         * \note On NEON each slot takes 4 bits of the mask, so SHIFT turns a bit position back into a slot index.
+         */
+        template<unsigned SHIFT>
+        class GroupMask{
+        public:
+            explicit GroupMask(std::uint64_t bits) noexcept : m_Bits(bits){}
+
+            inline explicit operator bool() const noexcept { return m_Bits != 0; }
+            inline unsigned lowest() const noexcept { return count_trailing_zeros(m_Bits) >> SHIFT; }
+
+            inline GroupMask& operator++() noexcept { m_Bits &= m_Bits - 1; return *this; }
+            inline unsigned operator*() const noexcept { return lowest(); }
+            inline GroupMask begin() const noexcept { return *this; }
+            inline GroupMask end() const noexcept { return GroupMask(0); }
+            inline bool operator!=(const GroupMask& rhs) const noexcept { return m_Bits != rhs.m_Bits; }
+
+        private:
+            std::uint64_t m_Bits;
+        };
+
+#if defined(MKTL_FLAT_HASH_SSE2)
+
+        /**
+         * \brief Sixteen control bytes, compared all at once with SSE2
+         */
+        class Group{
+        public:
+            using Mask = GroupMask<0>;
+
+            explicit Group(const std::int8_t* pControl) noexcept
+                    : m_Control(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pControl))){}
+
+            inline Mask match(std::int8_t tag) const noexcept {
+                return Mask(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), m_Control))));
+            }
+            inline Mask match_empty() const noexcept { return match(CONTROL_EMPTY); }
+            inline Mask match_empty_or_deleted() const noexcept {
+                // both have the sign bit set, full slots never do
+                return Mask(static_cast<std::uint32_t>(_mm_movemask_epi8(m_Control)));
+            }
+
+        private:
+            __m128i m_Control;
+        };
+
+#elif defined(MKTL_FLAT_HASH_NEON)
+
+        /**
+         * \brief Sixteen control bytes, compared all at once with NEON
+         * \note NEON has no movemask, so the compare result is narrowed to 4 bits per slot and one bit of each is kept
+         */
+        class Group{
+        public:
+            using Mask = GroupMask<2>;
+
+            explicit Group(const std::int8_t* pControl) noexcept : m_Control(vld1q_s8(pControl)){}
+
+            inline Mask match(std::int8_t tag) const noexcept { return to_mask(vceqq_s8(vdupq_n_s8(tag), m_Control)); }
+            inline Mask match_empty() const noexcept { return match(CONTROL_EMPTY); }
+            inline Mask match_empty_or_deleted() const noexcept { return to_mask(vcltq_s8(m_Control, vdupq_n_s8(0))); }
+
+        private:
+            static inline Mask to_mask(uint8x16_t compared) noexcept {
+                const uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(compared), 4);
+                return Mask(vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & 0x8888888888888888ULL);
+            }
+
+            int8x16_t m_Control;
+        };
+
+#else
+
+        /**
+         * \brief Sixteen control bytes, compared one at a time
+         */
+        class Group{
+        public:
+            using Mask = GroupMask<0>;
+
+            explicit Group(const std::int8_t* pControl) noexcept { std::memcpy(m_Control, pControl, GROUP_WIDTH); }
+
+            inline Mask match(std::int8_t tag) const noexcept {
+                std::uint64_t bits = 0;
+                for(std::size_t i = 0; i < GROUP_WIDTH; ++i){
+                    bits |= static_cast<std::uint64_t>(m_Control[i] == tag) << i;
+                }
+                return Mask(bits);
+            }
+            inline Mask match_empty() const noexcept { return match(CONTROL_EMPTY); }
+            inline Mask match_empty_or_deleted() const noexcept {
+                std::uint64_t bits = 0;
+                for(std::size_t i = 0; i < GROUP_WIDTH; ++i){
+                    bits |= static_cast<std::uint64_t>(m_Control[i] < 0) << i;
+                }
+                return Mask(bits);
+            }
+
+        private:
+            std::int8_t m_Control[GROUP_WIDTH];
+        };
+
+#endif
+
+        /**
+         * \brief The control bytes of a table with no slots. Lookups on it stop at the first group, so an empty table
+         * needs no allocation and no extra branch.
+         */
+        alignas(GROUP_WIDTH) inline const std::int8_t EMPTY_GROUP[GROUP_WIDTH] = {
+                CONTROL_EMPTY, CONTROL_EMPTY, CONTROL_EMPTY, CONTROL_EMPTY, CONTROL_EMPTY, CONTROL_EMPTY, CONTROL_EMPTY, CONTROL_EMPTY,
+                CONTROL_EMPTY, CONTROL_EMPTY, CONTROL_EMPTY, CONTROL_EMPTY, CONTROL_EMPTY, CONTROL_EMPTY, CONTROL_EMPTY, CONTROL_EMPTY
+        };
+
+        /**
+         * \brief Spreads a hash over all 64 bits, since std::hash is the identity for integers and pointers
+         * (murmur3's finalizer)
+         */
+        inline std::uint64_t mix_hash(std::uint64_t hash) noexcept {
+            hash ^= hash >> 33;
+            hash *= 0xFF51AFD7ED558CCDULL;
+            hash ^= hash >> 33;
+            hash *= 0xC4CEB9FE1A85EC53ULL;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        template<typename T, typename = void>
+        struct has_is_transparent : std::false_type{};
+
+        template<typename T>
+        struct has_is_transparent<T, std::void_t<typename T::is_transparent>> : std::true_type{};
+
+        // Heterogeneous lookup, as in std::unordered_map since C++20: only when both Hash and Eq opt in
+        template<bool Transparent>
+        struct KeyArg{
+            template<typename Query, typename Key>
+            using type = Key;
+        };
+
+        template<>
+        struct KeyArg<true>{
+            template<typename Query, typename Key>
+            using type = Query;
+        };
+
+        /**
+         * \brief The open addressing table behind FlatHashMap and FlatHashSet.
+         * Slots and control bytes live in one flat allocation. Each slot has a control byte holding either empty,
+         * deleted, or 7 bits of its hash. A lookup loads a whole group of 16 control bytes, compares them against the
+         * key's 7 bits in one go, and only compares keys for the slots that matched. Groups are probed quadratically and
+         * a lookup stops at the first group with an empty slot.
+         * @tparam Policy Describes the slot type and how to get its key
+         * @tparam Hash The hash function
+         * @tparam Eq The key equality function
+         */
+        template<typename Policy, typename Hash, typename Eq>
+        class FlatTable{
+        public:
+            using key_type = typename Policy::key_type;
+            using value_type = typename Policy::slot_type;
+            using size_type = std::size_t;
+            using hasher = Hash;
+            using key_equal = Eq;
+
+            static constexpr bool IS_TRANSPARENT = has_is_transparent<Hash>::value && has_is_transparent<Eq>::value;
+
+            template<typename Query>
+            using key_arg = typename KeyArg<IS_TRANSPARENT>::template type<Query, key_type>;
+
+            template<bool IsConst>
+            class Iterator{
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = typename Policy::slot_type;
+                using difference_type = std::ptrdiff_t;
+                using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+                using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+
+                Iterator() noexcept = default;
+                Iterator(const std::int8_t* pControl, pointer pSlot, const std::int8_t* pEnd) noexcept
+                        : m_pControl(pControl), m_pSlot(pSlot), m_pEnd(pEnd){ skip_empty(); }
+
+                // iterator to const_iterator
+                template<bool WasConst, typename = std::enable_if_t<IsConst && !WasConst>>
+                Iterator(const Iterator<WasConst>& other) noexcept
+                        : m_pControl(other.m_pControl), m_pSlot(other.m_pSlot), m_pEnd(other.m_pEnd){}
+
+                inline reference operator*() const noexcept { return *m_pSlot; }
+                inline pointer operator->() const noexcept { return m_pSlot; }
+
+                inline Iterator& operator++() noexcept { ++m_pControl; ++m_pSlot; skip_empty(); return *this; }
+                inline Iterator operator++(int) noexcept { Iterator old = *this; ++*this; return old; }
+
+                inline bool operator==(const Iterator& rhs) const noexcept { return m_pControl == rhs.m_pControl; }
+                inline bool operator!=(const Iterator& rhs) const noexcept { return m_pControl != rhs.m_pControl; }
+
+            private:
+                template<typename, typename, typename>
+                friend class FlatTable;
+                template<bool>
+                friend class Iterator;
+
+                inline void skip_empty() noexcept {
+                    while(m_pControl != m_pEnd && *m_pControl < 0){
+                        ++m_pControl;
+                        ++m_pSlot;
+                    }
+                }
+
+                const std::int8_t* m_pControl = nullptr;
+                pointer m_pSlot = nullptr;
+                const std::int8_t* m_pEnd = nullptr;
+            };
+
+            using iterator = Iterator<false>;
+            using const_iterator = Iterator<true>;
+
+            FlatTable() noexcept = default;
+            FlatTable(const FlatTable& other);
+            FlatTable(FlatTable&& other) noexcept;
+            FlatTable& operator=(const FlatTable& other);
+            FlatTable& operator=(FlatTable&& other) noexcept;
+            ~FlatTable();
+
+            [[nodiscard]] inline std::size_t size() const noexcept { return m_Size; }
+            [[nodiscard]] inline bool empty() const noexcept { return m_Size == 0; }
+            [[nodiscard]] inline std::size_t capacity() const noexcept { return m_Capacity; }
+
+            inline iterator begin() noexcept { return iterator(m_pControl, m_pSlots, m_pControl + m_Capacity); }
+            inline iterator end() noexcept { return iterator(m_pControl + m_Capacity, m_pSlots + m_Capacity, m_pControl + m_Capacity); }
+            inline const_iterator begin() const noexcept { return const_iterator(m_pControl, m_pSlots, m_pControl + m_Capacity); }
+            inline const_iterator end() const noexcept { return const_iterator(m_pControl + m_Capacity, m_pSlots + m_Capacity, m_pControl + m_Capacity); }
+
+            /**
+             * \brief Finds the slot holding a key
+             * @param key The key, or anything Hash and Eq accept if they are transparent
+             * @return An iterator to the slot, or end()
+             */
+            template<typename Query = key_type>
+            iterator find(const key_arg<Query>& key);
+
+            template<typename Query = key_type>
+            const_iterator find(const key_arg<Query>& key) const;
+
+            template<typename Query = key_type>
+            inline bool contains(const key_arg<Query>& key) const { return find<Query>(key) != end(); }
+
+            /**
+             * \brief Constructs a slot in place unless its key is already present
+             * @param args The arguments to construct the slot from
+             * @return An iterator to the slot with that key, and whether it was inserted
+             */
+            template<typename... Args>
+            std::pair<iterator, bool> emplace(Args&&... args);
+
+            inline std::pair<iterator, bool> insert(const value_type& value){ return emplace(value); }
+            inline std::pair<iterator, bool> insert(value_type&& value){ return emplace(std::move(value)); }
+
+            /**
+             * \brief Removes the slot holding a key
+             * @param key The key
+             * @return 1 if a slot was removed, otherwise 0
+             */
+            template<typename Query = key_type>
+            std::size_t erase(const key_arg<Query>& key);
+
+            /**
+             * \brief Removes the slot an iterator points at
+             * @param position The slot to remove
+             * @return An iterator to the next slot
+             */
+            iterator erase(const_iterator position);
+            inline iterator erase(iterator position){ return erase(const_iterator(position)); }
+
+            void clear() noexcept;
+
+            /**
+             * \brief Makes room for count elements without rehashing
+             * @param count The element count to make room for
+             */
+            void reserve(std::size_t count);
+
+        protected:
+            /**
+             * \brief Where a key is, or where it would go
+             */
+            struct PreparedSlot{
+                std::size_t index;
+                bool inserted; // the key was not found, construct_slot has to fill the slot
+                std::int8_t tag;
+            };
+
+            /**
+             * \brief Finds a key, or picks a free slot for it. A picked slot is not marked full until construct_slot
+             * succeeds, so nothing has to be undone if the caller fails to build the value.
+             * @param key The key
+             * @return The slot, and whether the caller has to construct it
+             */
+            template<typename K>
+            PreparedSlot find_or_prepare_insert(const K& key);
+
+            /**
+             * \brief Builds the value in a slot picked by find_or_prepare_insert, then marks the slot full
+             * @param slot The picked slot, with nothing inserted or rehashed since
+             * @param args The arguments to construct the value from
+             * @return The value
+             */
+            template<typename... Args>
+            value_type& construct_slot(const PreparedSlot& slot, Args&&... args);
+
+            inline iterator iterator_at(std::size_t index) noexcept {
+                return iterator(m_pControl + index, m_pSlots + index, m_pControl + m_Capacity);
+            }
+
+            value_type* m_pSlots = nullptr;
+
+        private:
+            static inline std::int8_t tag_of(std::uint64_t hash) noexcept { return static_cast<std::int8_t>(hash & 0x7F); }
+            static inline std::size_t group_of(std::uint64_t hash) noexcept { return static_cast<std::size_t>(hash >> 7); }
+
+            template<typename K>
+            inline std::uint64_t hash_of(const K& key) const { return mix_hash(static_cast<std::uint64_t>(Hash{}(key))); }
+
+            template<typename K>
+            std::size_t find_index(const K& key) const;
+
+            std::size_t find_insert_slot(std::uint64_t hash) const noexcept;
+            void set_control(std::size_t index, std::int8_t control) noexcept { m_pControl[index] = control; }
+
+            void rehash(std::size_t capacity);
+            void destroy_slots() noexcept;
+            void release() noexcept;
+
+            static inline std::size_t max_load(std::size_t capacity) noexcept { return capacity - capacity / 8; }
+
+            std::int8_t* m_pControl = const_cast<std::int8_t*>(EMPTY_GROUP);
+            std::size_t m_Capacity = 0;
+            std::size_t m_Size = 0;
+            std::size_t m_GrowthLeft = 0; // slots left before the next rehash, deleted slots count as used
+        };
+
+        template<typename K, typename V>
+        struct MapPolicy{
+            using key_type = K;
+            using slot_type = std::pair<const K, V>;
+
+            static inline const K& key(const slot_type& slot) noexcept { return slot.first; }
+        };
+
+        template<typename K>
+        struct SetPolicy{
+            using key_type = K;
+            using slot_type = K;
+
+            static inline const K& key(const slot_type& slot) noexcept { return slot; }
+        };
+
+    }
+
+    /**
+     * \brief A cache friendly open addressing hash map, laid out like Abseil's Swiss tables.
+     * Every entry lives in one flat array, so there is a single allocation per rehash instead of one per node, and a
+     * lookup usually touches one cache line of control bytes and one slot.
+     * \note Unlike std::unordered_map, references and iterators are invalidated by any insertion that rehashes.
+     * @tparam K The key type
+     * @tparam V The mapped type
+     * @tparam Hash The hash function, make it transparent (is_transparent) for heterogeneous lookup
+     * @tparam Eq The key equality function, must also be transparent for heterogeneous lookup
+     */
+    template<typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+    class FlatHashMap : public detail::FlatTable<detail::MapPolicy<K, V>, Hash, Eq>{
+        using Base = detail::FlatTable<detail::MapPolicy<K, V>, Hash, Eq>;
+
+    public:
+        using mapped_type = V;
+        using typename Base::iterator;
+        using typename Base::const_iterator;
+
+        template<typename Query>
+        using key_arg = typename Base::template key_arg<Query>;
+
+        /**
+         * \brief Finds a key's value, or value initializes one
+         * @param key The key
+         * @return The value
+         */
+        V& operator[](const K& key);
+        V& operator[](K&& key);
+
+        /**
+         * \brief Constructs a value for key unless key is already present. The key is only copied or moved into the map
+         * when it is inserted.
+         * @param key The key
+         * @param args The arguments to construct the value from
+         * @return The new value, or HashMapError::KeyExists
+         */
+        template<typename... Args>
+        inline Result<std::reference_wrapper<V>, HashMapError> try_emplace(const K& key, Args&&... args){
+            return try_emplace_key(key, std::forward<Args>(args)...);
+        }
+
+        template<typename... Args>
+        inline Result<std::reference_wrapper<V>, HashMapError> try_emplace(K&& key, Args&&... args){
+            return try_emplace_key(std::move(key), std::forward<Args>(args)...);
+        }
+
+        /**
+         * \brief Looks a key up without an iterator
+         * @param key The key
+         * @return The value, or HashMapError::NotFound
+         */
+        template<typename Query = K>
+        Result<std::reference_wrapper<V>, HashMapError> try_find(const key_arg<Query>& key);
+
+        template<typename Query = K>
+        Result<std::reference_wrapper<const V>, HashMapError> try_find(const key_arg<Query>& key) const;
+
+    private:
+        template<typename KeyRef, typename... Args>
+        Result<std::reference_wrapper<V>, HashMapError> try_emplace_key(KeyRef&& key, Args&&... args);
+    };
+
+    /**
+     * \brief A cache friendly open addressing hash set, the set counterpart of FlatHashMap
+     * @tparam K The key type
+     * @tparam Hash The hash function
+     * @tparam Eq The key equality function
+     */
+    template<typename K, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+    class FlatHashSet : public detail::FlatTable<detail::SetPolicy<K>, Hash, Eq>{
+        using Base = detail::FlatTable<detail::SetPolicy<K>, Hash, Eq>;
+
+    public:
+        template<typename Query>
+        using key_arg = typename Base::template key_arg<Query>;
+
+        /**
+         * \brief Inserts a key unless it is already present. The key is only copied or moved into the set when it is
+         * inserted.
+         * @param key The key
+         * @return A reference to the stored key, or HashMapError::KeyExists
+         */
+        inline Result<std::reference_wrapper<const K>, HashMapError> try_emplace(const K& key){ return try_emplace_key(key); }
+        inline Result<std::reference_wrapper<const K>, HashMapError> try_emplace(K&& key){ return try_emplace_key(std::move(key)); }
+
+        /**
+         * \brief Looks a key up without an iterator
+         * @param key The key
+         * @return A reference to the stored key, or HashMapError::NotFound
+         */
+        template<typename Query = K>
+        Result<std::reference_wrapper<const K>, HashMapError> try_find(const key_arg<Query>& key) const;
+
+    private:
+        template<typename KeyRef>
+        Result<std::reference_wrapper<const K>, HashMapError> try_emplace_key(KeyRef&& key);
+    };
+
+
+    //////////////////////////////////////////////////
+    //                  FlatTable                   //
+    //////////////////////////////////////////////////
+
+    namespace detail{
+
+        template<typename Policy, typename Hash, typename Eq>
+        FlatTable<Policy, Hash, Eq>::FlatTable(const FlatTable& other){
+            // No destructor runs for a constructor that throws, so clean up by hand
+            try{
+                reserve(other.size());
+                for(const value_type& slot : other){
+                    construct_slot(find_or_prepare_insert(Policy::key(slot)), slot);
+                }
+            }catch(...){
+                destroy_slots();
+                release();
+                throw;
+            }
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        FlatTable<Policy, Hash, Eq>::FlatTable(FlatTable&& other) noexcept
+                : m_pSlots(std::exchange(other.m_pSlots, nullptr)),
+                  m_pControl(std::exchange(other.m_pControl, const_cast<std::int8_t*>(EMPTY_GROUP))),
+                  m_Capacity(std::exchange(other.m_Capacity, 0)),
+                  m_Size(std::exchange(other.m_Size, 0)),
+                  m_GrowthLeft(std::exchange(other.m_GrowthLeft, 0)){}
+
+        template<typename Policy, typename Hash, typename Eq>
+        FlatTable<Policy, Hash, Eq>& FlatTable<Policy, Hash, Eq>::operator=(const FlatTable& other){
+            if(this != &other){
+                FlatTable copy(other);
+                *this = std::move(copy);
+            }
+            return *this;
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        FlatTable<Policy, Hash, Eq>& FlatTable<Policy, Hash, Eq>::operator=(FlatTable&& other) noexcept {
+            if(this != &other){
+                destroy_slots();
+                release();
+                m_pSlots = std::exchange(other.m_pSlots, nullptr);
+                m_pControl = std::exchange(other.m_pControl, const_cast<std::int8_t*>(EMPTY_GROUP));
+                m_Capacity = std::exchange(other.m_Capacity, 0);
+                m_Size = std::exchange(other.m_Size, 0);
+                m_GrowthLeft = std::exchange(other.m_GrowthLeft, 0);
+            }
+            return *this;
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        FlatTable<Policy, Hash, Eq>::~FlatTable(){
+            destroy_slots();
+            release();
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        template<typename K>
+        std::size_t FlatTable<Policy, Hash, Eq>::find_index(const K& key) const {
+            const std::uint64_t hash = hash_of(key);
+            const std::int8_t tag = tag_of(hash);
+
+            // An empty table has one read-only group of empty bytes and a group mask of 0
+            const std::size_t groupMask = m_Capacity ? m_Capacity / GROUP_WIDTH - 1 : 0;
+            std::size_t group = group_of(hash) & groupMask;
+
+            for(std::size_t probe = 1; ; ++probe){
+                const std::size_t base = group * GROUP_WIDTH;
+                const Group controlGroup(m_pControl + base);
+
+                for(unsigned offset : controlGroup.match(tag)){
+                    if(Eq{}(Policy::key(m_pSlots[base + offset]), key)){
+                        return base + offset;
+                    }
+                }
+
+                if(controlGroup.match_empty() || probe > groupMask){
+                    return m_Capacity;
+                }
+
+                group = (group + probe) & groupMask;
+            }
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        std::size_t FlatTable<Policy, Hash, Eq>::find_insert_slot(std::uint64_t hash) const noexcept {
+            const std::size_t groupMask = m_Capacity / GROUP_WIDTH - 1;
+            std::size_t group = group_of(hash) & groupMask;
+
+            // the load factor guarantees there is a free slot somewhere
+            for(std::size_t probe = 1; ; ++probe){
+                const std::size_t base = group * GROUP_WIDTH;
+                if(auto freeSlots = Group(m_pControl + base).match_empty_or_deleted()){
+                    return base + freeSlots.lowest();
+                }
+                group = (group + probe) & groupMask;
+            }
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        template<typename Query>
+        typename FlatTable<Policy, Hash, Eq>::iterator FlatTable<Policy, Hash, Eq>::find(const key_arg<Query>& key){
+            const std::size_t index = find_index(key);
+            return index == m_Capacity ? end() : iterator_at(index);
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        template<typename Query>
+        typename FlatTable<Policy, Hash, Eq>::const_iterator FlatTable<Policy, Hash, Eq>::find(const key_arg<Query>& key) const {
+            const std::size_t index = find_index(key);
+            return index == m_Capacity ? end()
+                                       : const_iterator(m_pControl + index, m_pSlots + index, m_pControl + m_Capacity);
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        template<typename K>
+        typename FlatTable<Policy, Hash, Eq>::PreparedSlot FlatTable<Policy, Hash, Eq>::find_or_prepare_insert(const K& key){
+            const std::size_t existing = find_index(key);
+            if(existing != m_Capacity){
+                return {existing, false, m_pControl[existing]};
+            }
+
+            const std::uint64_t hash = hash_of(key);
+            std::size_t index = m_Capacity ? find_insert_slot(hash) : 0;
+
+            // Only an empty slot uses up growth, so there is no need to rehash when a deleted one can be reused
+            if(m_Capacity == 0 || (m_GrowthLeft == 0 && m_pControl[index] == CONTROL_EMPTY)){
+                rehash(m_Capacity == 0 ? GROUP_WIDTH : (m_Size + 1 > max_load(m_Capacity) / 2 ? m_Capacity * 2 : m_Capacity));
+                index = find_insert_slot(hash);
+            }
+
+            return {index, true, tag_of(hash)};
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        template<typename... Args>
+        typename FlatTable<Policy, Hash, Eq>::value_type& FlatTable<Policy, Hash, Eq>::construct_slot(const PreparedSlot& slot, Args&&... args){
+            auto* pValue = new (m_pSlots + slot.index) value_type(std::forward<Args>(args)...);
+
+            // Reusing a deleted slot does not use up any growth, taking an empty one does
+            if(m_pControl[slot.index] == CONTROL_EMPTY){
+                --m_GrowthLeft;
+            }
+            set_control(slot.index, slot.tag);
+            ++m_Size;
+            return *pValue;
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        template<typename... Args>
+        std::pair<typename FlatTable<Policy, Hash, Eq>::iterator, bool> FlatTable<Policy, Hash, Eq>::emplace(Args&&... args){
+            // The key is needed before the slot exists, so build the value on the side first.
+            // Callers that already have the key, like try_emplace and operator[], skip this.
+            alignas(value_type) unsigned char buffer[sizeof(value_type)];
+            auto* pValue = new (buffer) value_type(std::forward<Args>(args)...);
+
+            PreparedSlot slot;
+            try{
+                slot = find_or_prepare_insert(Policy::key(*pValue));
+                if(slot.inserted){
+                    construct_slot(slot, std::move(*pValue));
+                }
+            }catch(...){
+                pValue->~value_type();
+                throw;
+            }
+
+            pValue->~value_type();
+            return {iterator_at(slot.index), slot.inserted};
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        template<typename Query>
+        std::size_t FlatTable<Policy, Hash, Eq>::erase(const key_arg<Query>& key){
+            const std::size_t index = find_index(key);
+            if(index == m_Capacity){
+                return 0;
+            }
+            erase(const_iterator(m_pControl + index, m_pSlots + index, m_pControl + m_Capacity));
+            return 1;
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        typename FlatTable<Policy, Hash, Eq>::iterator FlatTable<Policy, Hash, Eq>::erase(const_iterator position){
+            const auto index = static_cast<std::size_t>(position.m_pControl - m_pControl);
+            MKTL_DEBUG_ASSERT(index < m_Capacity && m_pControl[index] >= 0, "FlatHashMap::erase on an empty slot or end()");
+            m_pSlots[index].~value_type();
+            --m_Size;
+
+            // A group that already has an empty slot never makes a probe continue past it, so this slot can simply
+            // become empty again. Otherwise it has to stay a tombstone to keep later groups reachable.
+            const std::size_t base = index - index % GROUP_WIDTH;
+            if(Group(m_pControl + base).match_empty()){
+                set_control(index, CONTROL_EMPTY);
+                ++m_GrowthLeft;
+            }else{
+                set_control(index, CONTROL_DELETED);
+            }
+
+            return iterator_at(index);
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        void FlatTable<Policy, Hash, Eq>::clear() noexcept {
+            destroy_slots();
+            if(m_Capacity){
+                std::memset(m_pControl, CONTROL_EMPTY, m_Capacity);
+            }
+            m_Size = 0;
+            m_GrowthLeft = max_load(m_Capacity);
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        void FlatTable<Policy, Hash, Eq>::reserve(std::size_t count){
+            std::size_t capacity = m_Capacity ? m_Capacity : GROUP_WIDTH;
+            while(max_load(capacity) < count){
+                capacity *= 2;
+            }
+            if(capacity > m_Capacity){
+                rehash(capacity);
+            }
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        void FlatTable<Policy, Hash, Eq>::rehash(std::size_t capacity){
+            value_type* pOldSlots = m_pSlots;
+            std::int8_t* pOldControl = m_pControl;
+            const std::size_t oldCapacity = m_Capacity;
+
+            // One allocation: the slots, then the control bytes
+            auto* pMemory = static_cast<unsigned char*>(::operator new(capacity * sizeof(value_type) + capacity));
+            m_pSlots = reinterpret_cast<value_type*>(pMemory);
+            m_pControl = reinterpret_cast<std::int8_t*>(pMemory + capacity * sizeof(value_type));
+            std::memset(m_pControl, CONTROL_EMPTY, capacity);
+            m_Capacity = capacity;
+            m_GrowthLeft = max_load(capacity) - m_Size;
+
+            for(std::size_t i = 0; i < oldCapacity; ++i){
+                if(pOldControl[i] < 0) continue;
+
+                const std::uint64_t hash = hash_of(Policy::key(pOldSlots[i]));
+                const std::size_t index = find_insert_slot(hash);
+                set_control(index, tag_of(hash));
+
+                if constexpr (is_trivially_relocatable_v<value_type>) {
+                    std::memcpy(static_cast<void*>(m_pSlots + index), static_cast<const void*>(pOldSlots + i), sizeof(value_type));
+                } else {
+                    new (m_pSlots + index) value_type(std::move(pOldSlots[i]));
+                    pOldSlots[i].~value_type();
+                }
+            }
+
+            if(oldCapacity){
+                ::operator delete(pOldSlots);
+            }
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        void FlatTable<Policy, Hash, Eq>::destroy_slots() noexcept {
+            if constexpr (!std::is_trivially_destructible_v<value_type>) {
+                for(std::size_t i = 0; i < m_Capacity; ++i){
+                    if(m_pControl[i] >= 0){
+                        m_pSlots[i].~value_type();
+                    }
+                }
+            }
+        }
+
+        template<typename Policy, typename Hash, typename Eq>
+        void FlatTable<Policy, Hash, Eq>::release() noexcept {
+            if(m_Capacity){
+                ::operator delete(m_pSlots);
+            }
+            m_pSlots = nullptr;
+            m_pControl = const_cast<std::int8_t*>(EMPTY_GROUP);
+            m_Capacity = 0;
+            m_Size = 0;
+            m_GrowthLeft = 0;
+        }
+
+    }
+
+    //////////////////////////////////////////////////
+    //                 FlatHashMap                  //
+    //////////////////////////////////////////////////
+
+    template<typename K, typename V, typename Hash, typename Eq>
+    V& FlatHashMap<K, V, Hash, Eq>::operator[](const K& key){
+        const auto slot = this->find_or_prepare_insert(key);
+        if(slot.inserted){
+            this->construct_slot(slot, std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>());
+        }
+        return this->m_pSlots[slot.index].second;
+    }
+
+    template<typename K, typename V, typename Hash, typename Eq>
+    V& FlatHashMap<K, V, Hash, Eq>::operator[](K&& key){
+        const auto slot = this->find_or_prepare_insert(key);
+        if(slot.inserted){
+            this->construct_slot(slot, std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::tuple<>());
+        }
+        return this->m_pSlots[slot.index].second;
+    }
+
+    template<typename K, typename V, typename Hash, typename Eq>
+    template<typename KeyRef, typename... Args>
+    Result<std::reference_wrapper<V>, HashMapError> FlatHashMap<K, V, Hash, Eq>::try_emplace_key(KeyRef&& key, Args&&... args){
+        const auto slot = this->find_or_prepare_insert(key);
+        if(!slot.inserted){
+            return Result<std::reference_wrapper<V>, HashMapError>(HashMapError::KeyExists);
+        }
+
+        auto& value = this->construct_slot(slot, std::piecewise_construct,
+                                           std::forward_as_tuple(std::forward<KeyRef>(key)),
+                                           std::forward_as_tuple(std::forward<Args>(args)...));
+        return Result<std::reference_wrapper<V>, HashMapError>(std::ref(value.second));
+    }
+
+    template<typename K, typename V, typename Hash, typename Eq>
+    template<typename Query>
+    Result<std::reference_wrapper<V>, HashMapError> FlatHashMap<K, V, Hash, Eq>::try_find(const key_arg<Query>& key){
+        auto found = this->template find<Query>(key);
+        if(found == this->end()){
+            return Result<std::reference_wrapper<V>, HashMapError>(HashMapError::NotFound);
+        }
+        return Result<std::reference_wrapper<V>, HashMapError>(std::ref(found->second));
+    }
+
+    template<typename K, typename V, typename Hash, typename Eq>
+    template<typename Query>
+    Result<std::reference_wrapper<const V>, HashMapError> FlatHashMap<K, V, Hash, Eq>::try_find(const key_arg<Query>& key) const {
+        auto found = this->template find<Query>(key);
+        if(found == this->end()){
+            return Result<std::reference_wrapper<const V>, HashMapError>(HashMapError::NotFound);
+        }
+        return Result<std::reference_wrapper<const V>, HashMapError>(std::cref(found->second));
+    }
+
+    //////////////////////////////////////////////////
+    //                 FlatHashSet                  //
+    //////////////////////////////////////////////////
+
+    template<typename K, typename Hash, typename Eq>
+    template<typename KeyRef>
+    Result<std::reference_wrapper<const K>, HashMapError> FlatHashSet<K, Hash, Eq>::try_emplace_key(KeyRef&& key){
+        const auto slot = this->find_or_prepare_insert(key);
+        if(!slot.inserted){
+            return Result<std::reference_wrapper<const K>, HashMapError>(HashMapError::KeyExists);
+        }
+
+        return Result<std::reference_wrapper<const K>, HashMapError>(std::cref(this->construct_slot(slot, std::forward<KeyRef>(key))));
+    }
+
+    template<typename K, typename Hash, typename Eq>
+    template<typename Query>
+    Result<std::reference_wrapper<const K>, HashMapError> FlatHashSet<K, Hash, Eq>::try_find(const key_arg<Query>& key) const {
+        auto found = this->template find<Query>(key);
+        if(found == this->end()){
+            return Result<std::reference_wrapper<const K>, HashMapError>(HashMapError::NotFound);
+        }
+        return Result<std::reference_wrapper<const K>, HashMapError>(std::cref(*found));
+    }
+
+}
+
+#endif //MKTL_FLAT_HASH_MAP_HPP
@@ -0,0 +1,500 @@
+/********************************************************************************
+ *  MCKRUEG STL - mckrueg's standard template library of C++ useful stuff       *
+ *  Copyright (C) 2024 Matthew Krueger <contact@matthewkrueger.com>             *
+ *                                                                              *
+ *  This program is free software: you can redistribute it and/or modify        *
+ *  it under the terms of the GNU General Public License as published by        *
+ *  the Free Software Foundation, either version 3 of the License, or           *
+ *  (at your option) any later version.                                         *
+ *                                                                              *
+ *  This program is distributed in the hope that it will be useful,             *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ *  GNU General Public License for more details.                                *
+ *                                                                              *
+ *  You should have received a copy of the GNU General Public License           *
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+ ********************************************************************************/
+
+/*************************************
+ * The mckrueg stl requires
+ * C++ 17
+ *************************************/
+
+#if __cplusplus < 201703L
+# error MCKRUEG STL requires the use of C++ 17
+#endif
+
+#ifndef MKTL_LOCK_FREE_QUEUE_HPP
+#define MKTL_LOCK_FREE_QUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "Result.hpp"
+
+namespace mckrueg::stl{
+
+    /**
+     * \brief Why a non-blocking queue operation did not go through
+     */
+    enum class QueueError{
+        Full,
+        Empty
+    };
+
+    inline std::ostream& operator<<(std::ostream& os, QueueError error){
+        return os << (error == QueueError::Full ? "Queue is full" : "Queue is empty");
+    }
+
+    namespace detail{
+
+        /**
+         * \brief Cache line aligned storage for a queue's slots.
+         * The memory comes from the global operator new, which is the mktl allocator when memory tracking is on, so
+         * queue storage shows up in the tracker counters.
+         */
+        class QueueStorage{
+        public:
+            static constexpr std::size_t ALIGNMENT = 64;
+
+            explicit QueueStorage(std::size_t bytes)
+                    : m_pAllocation(::operator new(bytes + ALIGNMENT)){
+                auto address = reinterpret_cast<std::uintptr_t>(m_pAllocation);
+                m_pAligned = reinterpret_cast<void*>((address + ALIGNMENT - 1) & ~(static_cast<std::uintptr_t>(ALIGNMENT) - 1));
+            }
+            QueueStorage(const QueueStorage&) = delete;
+            QueueStorage& operator=(const QueueStorage&) = delete;
+            ~QueueStorage(){ ::operator delete(m_pAllocation); }
+
+            [[nodiscard]] inline void* get() const noexcept { return m_pAligned; }
+
+        private:
+            void* m_pAllocation;
+            void* m_pAligned;
+        };
+
+        inline std::size_t round_up_to_power_of_two(std::size_t value) noexcept {
+            std::size_t rounded = 2;
+            while(rounded < value){
+                rounded <<= 1;
+            }
+            return rounded;
+        }
+
+    }
+
+    /**
+     * \brief A bounded, lock-free, single producer single consumer ring buffer.
+     * Each side owns one index and keeps a cached copy of the other side's index, so it only touches the other side's
+     * cache line when the cached copy says the queue is full or empty.
+     * \note Exactly one thread may push and exactly one thread may pop.
+     * @tparam T The element type
+     */
+    template<typename T>
+    class SPSCQueue{
+        static_assert(alignof(T) <= detail::QueueStorage::ALIGNMENT, "Over aligned elements are not supported");
+
+    public:
+        /**
+         * \brief Creates an empty queue
+         * @param capacity The capacity, rounded up to a power of two
+         */
+        explicit SPSCQueue(std::size_t capacity);
+        SPSCQueue(const SPSCQueue&) = delete;
+        SPSCQueue& operator=(const SPSCQueue&) = delete;
+        ~SPSCQueue();
+
+        /**
+         * \brief Pushes an element if there is room. Producer only
+         * @param value The element, only moved from on success
+         * @return Nothing, or QueueError::Full
+         */
+        Result<std::monostate, QueueError> try_push(T&& value);
+        Result<std::monostate, QueueError> try_push(const T& value);
+
+        /**
+         * \brief Pops the oldest element if there is one. Consumer only
+         * @return The element, or QueueError::Empty
+         */
+        Result<T, QueueError> try_pop();
+
+        /**
+         * \brief Pushes as many elements as fit, publishing them all at once. Producer only
+         * @param pValues The elements, the pushed prefix is moved from
+         * @param count How many elements to push
+         * @return How many elements were pushed
+         */
+        std::size_t try_push_batch(T* pValues, std::size_t count);
+
+        /**
+         * \brief Pops up to maxCount elements, releasing their slots all at once. Consumer only
+         * @param pOut Where to move the elements. Must point at maxCount constructed elements
+         * @param maxCount How many elements to pop at most
+         * @return How many elements were popped
+         */
+        std::size_t try_pop_batch(T* pOut, std::size_t maxCount);
+
+        [[nodiscard]] inline std::size_t capacity() const noexcept { return m_Mask + 1; }
+
+        /**
+         * \brief A racy estimate of how many elements are queued
+         * @return The estimated size
+         */
+        [[nodiscard]] std::size_t size_estimate() const noexcept;
+
+    private:
+        template<typename U>
+        Result<std::monostate, QueueError> push_one(U&& value);
+
+        std::size_t free_slots(std::size_t tail) noexcept;
+        std::size_t used_slots(std::size_t head) noexcept;
+
+        inline T* slot(std::size_t index) const noexcept { return m_pSlots + (index & m_Mask); }
+
+        // Consumer side
+        alignas(64) std::atomic<std::size_t> m_Head{0};
+        std::size_t m_CachedTail = 0;
+
+        // Producer side
+        alignas(64) std::atomic<std::size_t> m_Tail{0};
+        std::size_t m_CachedHead = 0;
+
+        // Read only after construction
+        alignas(64) std::size_t m_Mask;
+        detail::QueueStorage m_Storage;
+        T* m_pSlots;
+    };
+
+    /**
+     * \brief A bounded, lock-free, multi producer multi consumer queue, after Dmitry Vyukov's bounded MPMC queue.
+     * Every cell carries a sequence number that says whether it is ready to be written or read at a given position, so
+     * producers and consumers only contend on their own position counter.
+     * @tparam T The element type
+     */
+    template<typename T>
+    class MPMCQueue{
+        static_assert(alignof(T) <= detail::QueueStorage::ALIGNMENT, "Over aligned elements are not supported");
+
+    public:
+        /**
+         * \brief Creates an empty queue
+         * @param capacity The capacity, rounded up to a power of two
+         */
+        explicit MPMCQueue(std::size_t capacity);
+        MPMCQueue(const MPMCQueue&) = delete;
+        MPMCQueue& operator=(const MPMCQueue&) = delete;
+        ~MPMCQueue();
+
+        /**
+         * \brief Pushes an element if there is room
+         * @param value The element, only moved from on success
+         * @return Nothing, or QueueError::Full
+         */
+        Result<std::monostate, QueueError> try_push(T&& value);
+        Result<std::monostate, QueueError> try_push(const T& value);
+
+        /**
+         * \brief Pops the oldest element if there is one
+         * @return The element, or QueueError::Empty
+         */
+        Result<T, QueueError> try_pop();
+
+        /**
+         * \brief Pushes elements until the queue is full
+         * @param pValues The elements, the pushed prefix is moved from
+         * @param count How many elements to push
+         * @return How many elements were pushed
+         */
+        std::size_t try_push_batch(T* pValues, std::size_t count);
+
+        /**
+         * \brief Pops elements until the queue is empty or maxCount were popped
+         * @param pOut Where to move the elements. Must point at maxCount constructed elements
+         * @param maxCount How many elements to pop at most
+         * @return How many elements were popped
+         */
+        std::size_t try_pop_batch(T* pOut, std::size_t maxCount);
+
+        [[nodiscard]] inline std::size_t capacity() const noexcept { return m_Mask + 1; }
+
+    private:
+        struct Cell{
+            std::atomic<std::size_t> sequence;
+            alignas(T) unsigned char storage[sizeof(T)];
+
+            inline T* value() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+        };
+
+        Cell* claim_for_push(std::size_t& position) noexcept;
+        Cell* claim_for_pop(std::size_t& position) noexcept;
+
+        template<typename U>
+        bool push_one(U&& value);
+        bool pop_one(T& out);
+
+        alignas(64) std::atomic<std::size_t> m_EnqueuePosition{0};
+        alignas(64) std::atomic<std::size_t> m_DequeuePosition{0};
+
+        // Read only after construction
+        alignas(64) std::size_t m_Mask;
+        detail::QueueStorage m_Storage;
+        Cell* m_pCells;
+    };
+
+
+    //////////////////////////////////////////////////
+    //                  SPSCQueue                   //
+    //////////////////////////////////////////////////
+
+    template<typename T>
+    SPSCQueue<T>::SPSCQueue(std::size_t capacity)
+            : m_Mask(detail::round_up_to_power_of_two(capacity) - 1),
+              m_Storage(sizeof(T) * (m_Mask + 1)),
+              m_pSlots(static_cast<T*>(m_Storage.get())){}
+
+    template<typename T>
+    SPSCQueue<T>::~SPSCQueue(){
+        const std::size_t tail = m_Tail.load(std::memory_order_relaxed);
+        for(std::size_t head = m_Head.load(std::memory_order_relaxed); head != tail; ++head){
+            slot(head)->~T();
+        }
+    }
+
+    template<typename T>
+    std::size_t SPSCQueue<T>::free_slots(std::size_t tail) noexcept {
+        std::size_t available = capacity() - (tail - m_CachedHead);
+        if(available == 0){
+            m_CachedHead = m_Head.load(std::memory_order_acquire);
+            available = capacity() - (tail - m_CachedHead);
+        }
+        return available;
+    }
+
+    template<typename T>
+    std::size_t SPSCQueue<T>::used_slots(std::size_t head) noexcept {
+        std::size_t available = m_CachedTail - head;
+        if(available == 0){
+            m_CachedTail = m_Tail.load(std::memory_order_acquire);
+            available = m_CachedTail - head;
+        }
+        return available;
+    }
+
+    template<typename T>
+    template<typename U>
+    Result<std::monostate, QueueError> SPSCQueue<T>::push_one(U&& value){
+        const std::size_t tail = m_Tail.load(std::memory_order_relaxed);
+        if(free_slots(tail) == 0){
+            return Result<std::monostate, QueueError>(QueueError::Full);
+        }
+
+        new (slot(tail)) T(std::forward<U>(value));
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return Result<std::monostate, QueueError>(std::monostate{});
+    }
+
+    template<typename T>
+    Result<std::monostate, QueueError> SPSCQueue<T>::try_push(T&& value){ return push_one(std::move(value)); }
+
+    template<typename T>
+    Result<std::monostate, QueueError> SPSCQueue<T>::try_push(const T& value){ return push_one(value); }
+
+    template<typename T>
+    Result<T, QueueError> SPSCQueue<T>::try_pop(){
+        const std::size_t head = m_Head.load(std::memory_order_relaxed);
+        if(used_slots(head) == 0){
+            return Result<T, QueueError>(QueueError::Empty);
+        }
+
+        T* pValue = slot(head);
+        Result<T, QueueError> result(std::move(*pValue));
+        pValue->~T();
+        m_Head.store(head + 1, std::memory_order_release);
+        return result;
+    }
+
+    template<typename T>
+    std::size_t SPSCQueue<T>::try_push_batch(T* pValues, std::size_t count){
+        const std::size_t tail = m_Tail.load(std::memory_order_relaxed);
+        const std::size_t pushed = std::min(count, free_slots(tail));
+
+        for(std::size_t i = 0; i < pushed; ++i){
+            new (slot(tail + i)) T(std::move(pValues[i]));
+        }
+        if(pushed){
+            m_Tail.store(tail + pushed, std::memory_order_release);
+        }
+        return pushed;
+    }
+
+    template<typename T>
+    std::size_t SPSCQueue<T>::try_pop_batch(T* pOut, std::size_t maxCount){
+        const std::size_t head = m_Head.load(std::memory_order_relaxed);
+        const std::size_t popped = std::min(maxCount, used_slots(head));
+
+        for(std::size_t i = 0; i < popped; ++i){
+            T* pValue = slot(head + i);
+            pOut[i] = std::move(*pValue);
+            pValue->~T();
+        }
+        if(popped){
+            m_Head.store(head + popped, std::memory_order_release);
+        }
+        return popped;
+    }
+
+    template<typename T>
+    std::size_t SPSCQueue<T>::size_estimate() const noexcept {
+        return m_Tail.load(std::memory_order_relaxed) - m_Head.load(std::memory_order_relaxed);
+    }
+
+    //////////////////////////////////////////////////
+    //                  MPMCQueue                   //
+    //////////////////////////////////////////////////
+
+    template<typename T>
+    MPMCQueue<T>::MPMCQueue(std::size_t capacity)
+            : m_Mask(detail::round_up_to_power_of_two(capacity) - 1),
+              m_Storage(sizeof(Cell) * (m_Mask + 1)),
+              m_pCells(static_cast<Cell*>(m_Storage.get())){
+        for(std::size_t i = 0; i <= m_Mask; ++i){
+            new (&m_pCells[i].sequence) std::atomic<std::size_t>(i);
+        }
+    }
+
+    template<typename T>
+    MPMCQueue<T>::~MPMCQueue(){
+        const std::size_t enqueuePosition = m_EnqueuePosition.load(std::memory_order_relaxed);
+        for(std::size_t i = m_DequeuePosition.load(std::memory_order_relaxed); i != enqueuePosition; ++i){
+            m_pCells[i & m_Mask].value()->~T();
+        }
+    }
+
+    template<typename T>
+    typename MPMCQueue<T>::Cell* MPMCQueue<T>::claim_for_push(std::size_t& position) noexcept {
+        position = m_EnqueuePosition.load(std::memory_order_relaxed);
+        while(true){
+            Cell* pCell = &m_pCells[position & m_Mask];
+            const std::size_t sequence = pCell->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+
+            if(difference == 0){
+                if(m_EnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+                    return pCell;
+                }
+            }else if(difference < 0){
+                // the cell still holds the element from one lap ago
+                return nullptr;
+            }else{
+                position = m_EnqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    template<typename T>
+    typename MPMCQueue<T>::Cell* MPMCQueue<T>::claim_for_pop(std::size_t& position) noexcept {
+        position = m_DequeuePosition.load(std::memory_order_relaxed);
+        while(true){
+            Cell* pCell = &m_pCells[position & m_Mask];
+            const std::size_t sequence = pCell->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+
+            if(difference == 0){
+                if(m_DequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+                    return pCell;
+                }
+            }else if(difference < 0){
+                // nothing has been written here yet
+                return nullptr;
+            }else{
+                position = m_DequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    template<typename T>
+    template<typename U>
+    bool MPMCQueue<T>::push_one(U&& value){
+        std::size_t position;
+        Cell* pCell = claim_for_push(position);
+        if(!pCell) return false;
+
+        new (pCell->storage) T(std::forward<U>(value));
+        pCell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename T>
+    bool MPMCQueue<T>::pop_one(T& out){
+        std::size_t position;
+        Cell* pCell = claim_for_pop(position);
+        if(!pCell) return false;
+
+        T* pValue = pCell->value();
+        out = std::move(*pValue);
+        pValue->~T();
+        pCell->sequence.store(position + m_Mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename T>
+    Result<std::monostate, QueueError> MPMCQueue<T>::try_push(T&& value){
+        if(push_one(std::move(value))){
+            return Result<std::monostate, QueueError>(std::monostate{});
+        }
+        return Result<std::monostate, QueueError>(QueueError::Full);
+    }
+
+    template<typename T>
+    Result<std::monostate, QueueError> MPMCQueue<T>::try_push(const T& value){
+        if(push_one(value)){
+            return Result<std::monostate, QueueError>(std::monostate{});
+        }
+        return Result<std::monostate, QueueError>(QueueError::Full);
+    }
+
+    template<typename T>
+    Result<T, QueueError> MPMCQueue<T>::try_pop(){
+        std::size_t position;
+        Cell* pCell = claim_for_pop(position);
+        if(!pCell){
+            return Result<T, QueueError>(QueueError::Empty);
+        }
+
+        // Moved straight into the Result so T does not need to be default constructible
+        T* pValue = pCell->value();
+        Result<T, QueueError> result(std::move(*pValue));
+        pValue->~T();
+        pCell->sequence.store(position + m_Mask + 1, std::memory_order_release);
+        return result;
+    }
+
+    template<typename T>
+    std::size_t MPMCQueue<T>::try_push_batch(T* pValues, std::size_t count){
+        std::size_t pushed = 0;
+        while(pushed < count && push_one(std::move(pValues[pushed]))){
+            ++pushed;
+        }
+        return pushed;
+    }
+
+    template<typename T>
+    std::size_t MPMCQueue<T>::try_pop_batch(T* pOut, std::size_t maxCount){
+        std::size_t popped = 0;
+        while(popped < maxCount && pop_one(pOut[popped])){
+            ++popped;
+        }
+        return popped;
+    }
+
+}
+
+#endif //MKTL_LOCK_FREE_QUEUE_HPP
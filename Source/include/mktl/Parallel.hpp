@@ -0,0 +1,230 @@
+/********************************************************************************
+ *  MCKRUEG STL - mckrueg's standard template library of C++ useful stuff       *
+ *  Copyright (C) 2024 Matthew Krueger <contact@matthewkrueger.com>             *
+ *                                                                              *
+ *  This program is free software: you can redistribute it and/or modify        *
+ *  it under the terms of the GNU General Public License as published by        *
+ *  the Free Software Foundation, either version 3 of the License, or           *
+ *  (at your option) any later version.                                         *
+ *                                                                              *
+ *  This program is distributed in the hope that it will be useful,             *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ *  GNU General Public License for more details.                                *
+ *                                                                              *
+ *  You should have received a copy of the GNU General Public License           *
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+ ********************************************************************************/
+
+/*************************************
+ * The mckrueg stl requires
+ * C++ 17
+ *************************************/
+
+#if __cplusplus < 201703L
+# error MCKRUEG STL requires the use of C++ 17
+#endif
+
+#ifndef MKTL_PARALLEL_HPP
+#define MKTL_PARALLEL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Result.hpp"
+
+// Parallel algorithms run on OpenMP when the library was configured with it (MKTL_BUILD_WITH_OPENMP) and the including
+// file is compiled with OpenMP enabled. Otherwise every algorithm here runs serially with the same results.
+#if defined(_OPENMP) && defined(MKTL_BUILD_WITH_OPENMP) && MKTL_BUILD_WITH_OPENMP
+#   include <omp.h>
+#   define MKTL_PARALLEL_USE_OPENMP 1
+#else
+#   define MKTL_PARALLEL_USE_OPENMP 0
+#endif
+
+namespace mckrueg::stl::parallel{
+
+    namespace detail{
+
+        /**
+         * \brief Tracks the lowest indexed error raised by any worker, and tells the others to stop
+         * @tparam Err The unwanted type
+         */
+        template<typename Err>
+        class FirstError{
+        public:
+            static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+            /**
+             * \brief Whether any worker has failed. Checked by every worker before each element
+             * @return if an error has been recorded
+             */
+            [[nodiscard]] inline bool cancelled() const noexcept { return m_Index.load(std::memory_order_relaxed) != NONE; }
+
+            /**
+             * \brief Records an error, keeping it only if it comes before every error seen so far
+             * @param index The element that failed
+             * @param error The error it failed with
+             */
+            void record(std::size_t index, const Err& error){
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if(index < m_Index.load(std::memory_order_relaxed)){
+                    m_Error.emplace(error);
+                    m_Index.store(index, std::memory_order_relaxed);
+                }
+            }
+
+            [[nodiscard]] inline const std::optional<Err>& error() const noexcept { return m_Error; }
+
+        private:
+            std::atomic<std::size_t> m_Index{NONE};
+            std::mutex m_Mutex;
+            std::optional<Err> m_Error;
+        };
+
+    }
+
+    /**
+     * \brief Returns how many workers the parallel algorithms will use
+     * @return The worker count, 1 when running serially
+     */
+    inline std::size_t worker_count() noexcept {
+#if MKTL_PARALLEL_USE_OPENMP
+        return static_cast<std::size_t>(omp_get_max_threads());
+#else
+        return 1;
+#endif
+    }
+
+    /**
+     * \brief Calls func(i) for every i in [0, count), split statically across the workers
+     * @tparam F The function to run
+     * @param count How many indices to run
+     * @param func The function to run for each index
+     */
+    template<typename F>
+    void parallel_for(std::size_t count, F&& func){
+        const auto signedCount = static_cast<std::ptrdiff_t>(count);
+#if MKTL_PARALLEL_USE_OPENMP
+#       pragma omp parallel for schedule(static)
+#endif
+        for(std::ptrdiff_t i = 0; i < signedCount; ++i){
+            func(static_cast<std::size_t>(i));
+        }
+    }
+
+    /**
+     * \brief Maps every element of input through func, in parallel
+     * \note U must be default constructible, as the output is sized up front so workers never reallocate it. U cannot be
+     * bool, std::vector<bool> packs its elements into shared bits so workers writing neighbours would race.
+     * @tparam U The type being transformed into
+     * @tparam T The type being transformed from
+     * @tparam F The function doing the transforming
+     * @param input The elements to transform
+     * @param func The function doing the transforming
+     * @return The transformed elements, in input order
+     */
+    template<typename U, typename T, typename F>
+    std::vector<U> transform(const std::vector<T>& input, F&& func){
+        static_assert(!std::is_same_v<U, bool>, "transform cannot produce bool, as std::vector<bool> elements share bytes");
+        std::vector<U> output(input.size());
+        parallel_for(input.size(), [&](std::size_t i){ output[i] = func(input[i]); });
+        return output;
+    }
+
+    /**
+     * \brief Folds input into init with op, in parallel
+     * \note Each worker folds one contiguous chunk, and the chunks are combined in order, so op has to be associative
+     * but does not have to be commutative. init is used exactly once.
+     * @tparam T The element type
+     * @tparam BinaryOp The combining function
+     * @param input The elements to fold
+     * @param init The starting value
+     * @param op The combining function, op(T, T) -> T
+     * @return The folded value
+     */
+    template<typename T, typename BinaryOp>
+    T reduce(const std::vector<T>& input, T init, BinaryOp&& op){
+        const std::size_t count = input.size();
+        std::vector<std::optional<T>> partials(worker_count());
+
+#if MKTL_PARALLEL_USE_OPENMP
+#       pragma omp parallel
+#endif
+        {
+#if MKTL_PARALLEL_USE_OPENMP
+            const auto worker = static_cast<std::size_t>(omp_get_thread_num());
+            const auto workers = static_cast<std::size_t>(omp_get_num_threads());
+#else
+            const std::size_t worker = 0;
+            const std::size_t workers = 1;
+#endif
+            const std::size_t begin = count * worker / workers;
+            const std::size_t end = count * (worker + 1) / workers;
+            if(begin < end){
+                T partial = input[begin];
+                for(std::size_t i = begin + 1; i < end; ++i){
+                    partial = op(std::move(partial), input[i]);
+                }
+                partials[worker].emplace(std::move(partial));
+            }
+        }
+
+        for(std::optional<T>& partial : partials){
+            if(partial){
+                init = op(std::move(init), std::move(*partial));
+            }
+        }
+        return init;
+    }
+
+    /**
+     * \brief Maps every element of input through a fallible func, in parallel, stopping every worker on the first error
+     * \note Workers check for cancellation before each element, and elements are handed out in small dynamic chunks so
+     * a failure stops the whole job quickly. Elements past a failure may never run, so when several elements would fail,
+     * which error is returned can differ between runs. Of the failures that did happen, the lowest indexed one wins.
+     * \note U must be default constructible and cannot be bool, for the same reasons as transform
+     * @tparam U The type being transformed into
+     * @tparam T The type being transformed from
+     * @tparam Err The unwanted type
+     * @tparam F The function doing the transforming, F(const T&) -> Result<U, Err>
+     * @param input The elements to transform
+     * @param func The function doing the transforming
+     * @return The transformed elements in input order, or the first error
+     */
+    template<typename U, typename Err, typename T, typename F>
+    Result<std::vector<U>, Err> try_transform(const std::vector<T>& input, F&& func){
+        static_assert(!std::is_same_v<U, bool>, "try_transform cannot produce bool, as std::vector<bool> elements share bytes");
+        std::vector<U> output(input.size());
+        detail::FirstError<Err> firstError;
+
+        const auto signedCount = static_cast<std::ptrdiff_t>(input.size());
+#if MKTL_PARALLEL_USE_OPENMP
+#       pragma omp parallel for schedule(dynamic, 64)
+#endif
+        for(std::ptrdiff_t i = 0; i < signedCount; ++i){
+            if(firstError.cancelled()) continue;
+
+            const auto index = static_cast<std::size_t>(i);
+            Result<U, Err> result = func(input[index]);
+            if(result.is_ok()){
+                output[index] = result.unwrap();
+            }else{
+                firstError.record(index, result.unwrap_err());
+            }
+        }
+
+        if(firstError.error()){
+            return Result<std::vector<U>, Err>(*firstError.error());
+        }
+        return Result<std::vector<U>, Err>(std::move(output));
+    }
+
+}
+
+#endif //MKTL_PARALLEL_HPP
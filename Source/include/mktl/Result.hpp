@@ -28,9 +28,16 @@
 #ifndef ASSIGNMENT_4_MCKRUEGSTL_RESULT_HPP
 #define ASSIGNMENT_4_MCKRUEGSTL_RESULT_HPP
 
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <optional>
+#include <string>
 #include <type_traits>
 #include <utility>
+#include <variant>
+
+#include "Traps.hpp"
 
 // Helper to check if a type can be used with std::ostream
 template<typename T>
@@ -63,6 +70,22 @@ auto has_ostream_operator(...) -> std::false_type;
 
 namespace mckrueg::stl{
 
+    namespace detail{
+        // Defined in ResultCoroutine.hpp, needs to move the payload out without a copy
+        template<typename Ok, typename Err, bool IsRvalue>
+        struct ResultAwaiter;
+
+        /**
+         * \brief The panic behind unwrap and expect, kept cold and out of line so the Ok path stays small
+         * @param message The message to panic with
+         * @param error The error held by the Result
+         */
+        template<typename Err>
+        [[noreturn]] MKTL_COLD void result_panic(const char* message, const Err& error) noexcept {
+            panic_error(message, error);
+        }
+    }
+
     /**
      * \brief A result monad inspired by rust
      * @tparam Ok The wanted type
@@ -75,20 +98,15 @@ namespace mckrueg::stl{
 
         Result(const Ok& value) : m_Value(value){}
         Result(const Err& value) : m_Value(value){}
+        Result(Ok&& value) : m_Value(std::move(value)){}
+        Result(Err&& value) : m_Value(std::move(value)){}
 
-        // Don't need a copy constructor as variant will copy correctly anyway.
-
-        /**
-         * Copy assignment operator
-         * @param other The rhs
-         * @return The lhs
-         */
-        inline Result<Ok, Err>& operator=(const Result<Ok, Err>& other){
-            if (this != &other) {
-                m_Value = other.m_Value;
-            }
-            return *this;
-        }
+        // All defaulted, so a Result of trivially copyable types is itself trivially copyable and is returned in
+        // registers rather than through memory. Variant already handles self assignment.
+        Result(const Result<Ok, Err>& other) = default;
+        Result(Result<Ok, Err>&& other) = default;
+        Result<Ok, Err>& operator=(const Result<Ok, Err>& other) = default;
+        Result<Ok, Err>& operator=(Result<Ok, Err>&& other) = default;
 
         /**
          * Checks if the stored value is of type OK
@@ -107,7 +125,12 @@ namespace mckrueg::stl{
          * \note Panics if not a Ok type
          * @return the Ok value
          */
-        [[nodiscard]] inline Ok unwrap() const noexcept { return expect("Result is not an Ok type"); };
+        [[nodiscard]] inline Ok unwrap() const noexcept {
+            if(MKTL_LIKELY(is_ok())){
+                return *std::get_if<Ok>(&m_Value);
+            }
+            detail::result_panic("Result is not an Ok type", *std::get_if<Err>(&m_Value));
+        };
 
         /**
          * \brief Unwraps the monad.
@@ -227,6 +250,11 @@ namespace mckrueg::stl{
         bool contains_err(const Err& error) const noexcept;
 
     private:
+        template<typename, typename, bool>
+        friend struct detail::ResultAwaiter;
+
+        // Only read through std::get_if after checking is_ok()/is_err(), std::get would check again and keep a
+        // bad_variant_access throw on the Ok path
         std::variant<Ok, Err> m_Value;
     };
 
@@ -236,12 +264,11 @@ namespace mckrueg::stl{
         Error() = default;
         explicit Error(std::string value) : m_Value(std::move(value)){};
 
-        inline Error& operator=(const Error& rhs){
-            if (this != &rhs) {
-                m_Value = rhs.m_Value;
-            }
-            return *this;
-        }
+        // Defaulted so Error keeps its noexcept move, a user written copy assignment would turn moves into copies
+        Error(const Error& other) = default;
+        Error(Error&& other) noexcept = default;
+        Error& operator=(const Error& rhs) = default;
+        Error& operator=(Error&& rhs) noexcept = default;
 
         [[nodiscard]] inline const std::string& get() const { return m_Value; }
 
@@ -255,17 +282,17 @@ namespace mckrueg::stl{
 
     template<typename Ok, typename Err>
     Ok Result<Ok, Err>::expect(const std::string &message) const noexcept {
-        if(is_ok()){
-            return std::get<Ok>(m_Value);
+        if(MKTL_LIKELY(is_ok())){
+            return *std::get_if<Ok>(&m_Value);
         }else{
-            panic_error(message,std::get<Err>(m_Value));
+            detail::result_panic(message.c_str(), *std::get_if<Err>(&m_Value));
         }
     }
 
     template<typename Ok, typename Err>
     Ok Result<Ok, Err>::unwrap_or(Ok defaultValue) const noexcept {
         if(is_ok()){
-            return std::get<Ok>(m_Value);
+            return *std::get_if<Ok>(&m_Value);
         }else{
             return defaultValue;
         }
@@ -274,7 +301,7 @@ namespace mckrueg::stl{
     template<typename Ok, typename Err>
     Ok Result<Ok, Err>::unwrap_or_else(std::function<Ok()> func) const noexcept {
         if(is_ok()){
-            return std::get<Ok>(m_Value);
+            return *std::get_if<Ok>(&m_Value);
         }else{
             return func();
         }
@@ -282,8 +309,8 @@ namespace mckrueg::stl{
 
     template<typename Ok, typename Err>
     Err Result<Ok, Err>::unwrap_err() const{
-        if(is_err()){
-            return std::get<Err>(m_Value);
+        if(MKTL_LIKELY(is_err())){
+            return *std::get_if<Err>(&m_Value);
         }else{
             panic("Cannot unwrap an valid type as an error");
         }
@@ -311,9 +338,9 @@ namespace mckrueg::stl{
     Result<U, Err> Result<Ok, Err>::map(F &&func) const noexcept{
 
         if(is_ok()){
-            return Result<U, Err>(func(std::get<Ok>(m_Value)));
+            return Result<U, Err>(func(*std::get_if<Ok>(&m_Value)));
         } else{
-            return Result<U, Err>(std::get<Err>(m_Value));
+            return Result<U, Err>(*std::get_if<Err>(&m_Value));
         }
 
     }
@@ -323,9 +350,9 @@ namespace mckrueg::stl{
     Result<Ok, E> Result<Ok, Err>::map_err(F &&func) const noexcept {
 
         if(is_err()){
-            return Result<Ok, E>(func(std::get<Err>(m_Value)));
+            return Result<Ok, E>(func(*std::get_if<Err>(&m_Value)));
         } else{
-            return Result<Ok, E>(std::get<Ok>(m_Value));
+            return Result<Ok, E>(*std::get_if<Ok>(&m_Value));
         }
 
     }
@@ -333,7 +360,7 @@ namespace mckrueg::stl{
     template<typename Ok, typename Err>
     std::optional<Ok> Result<Ok, Err>::ok() const noexcept {
         if (is_ok()){
-            return {std::get<Ok>()};
+            return {*std::get_if<Ok>(&m_Value)};
         } else {
             return {};
         }
@@ -342,7 +369,7 @@ namespace mckrueg::stl{
     template<typename Ok, typename Err>
     std::optional<Err> Result<Ok, Err>::err() const noexcept {
         if (is_err()){
-            return {std::get<Err>()};
+            return {*std::get_if<Err>(&m_Value)};
         } else {
             return {};
         }
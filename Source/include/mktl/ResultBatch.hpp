@@ -0,0 +1,394 @@
+/********************************************************************************
+ *  MCKRUEG STL - mckrueg's standard template library of C++ useful stuff       *
+ *  Copyright (C) 2024 Matthew Krueger <contact@matthewkrueger.com>             *
+ *                                                                              *
+ *  This program is free software: you can redistribute it and/or modify        *
+ *  it under the terms of the GNU General Public License as published by        *
+ *  the Free Software Foundation, either version 3 of the License, or           *
+ *  (at your option) any later version.                                         *
+ *                                                                              *
+ *  This program is distributed in the hope that it will be useful,             *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ *  GNU General Public License for more details.                                *
+ *                                                                              *
+ *  You should have received a copy of the GNU General Public License           *
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+ ********************************************************************************/
+
+/*************************************
+ * The mckrueg stl requires
+ * C++ 17
+ *************************************/
+
+#if __cplusplus < 201703L
+# error MCKRUEG STL requires the use of C++ 17
+#endif
+
+#ifndef MKTL_RESULT_BATCH_HPP
+#define MKTL_RESULT_BATCH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Result.hpp"
+#include "Traps.hpp"
+
+namespace mckrueg::stl{
+
+    namespace detail{
+
+        /**
+         * \brief Counts the set bits of a mask word
+         * @param word The word
+         * @return The number of set bits
+         */
+        inline std::size_t popcount64(std::uint64_t word) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<std::size_t>(__builtin_popcountll(word));
+#else
+            word = word - ((word >> 1) & 0x5555555555555555ULL);
+            word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+            word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+            return static_cast<std::size_t>((word * 0x0101010101010101ULL) >> 56);
+#endif
+        }
+
+    }
+
+    /**
+     * \brief A structure-of-arrays batch of Results.
+     * Ok values live in one dense array with a slot for every element, errors live in a second dense array together
+     * with the index they belong to, and a bitmask records which elements are Ok. Errors are expected to be rare, so the
+     * hot loops only ever walk the value array and the mask.
+     * \note Error slots of the value array hold a value initialized Ok, so Ok must be default constructible.
+     * @tparam Ok The wanted type
+     * @tparam Err The unwanted type
+     */
+    template<typename Ok, typename Err>
+    class ResultBatch{
+        static_assert(!std::is_same_v<Ok, bool>, "ResultBatch cannot hold bool, as std::vector<bool> is not contiguous");
+
+    public:
+        static constexpr std::size_t BITS_PER_WORD = 64;
+
+        ResultBatch() = default;
+
+        /**
+         * \brief Creates an empty batch with room for capacity elements
+         * @param capacity How many elements to reserve for
+         */
+        explicit ResultBatch(std::size_t capacity);
+
+        /**
+         * \brief Splits an array of Results into a batch
+         * @param results The Results to convert
+         * @return The batch
+         */
+        static ResultBatch<Ok, Err> from_results(const std::vector<Result<Ok, Err>>& results);
+
+        /**
+         * \brief Joins the batch back into an array of Results
+         * @return One Result per element, in order
+         */
+        std::vector<Result<Ok, Err>> to_results() const;
+
+        /**
+         * \brief Appends a single Result
+         * @param result The Result to append
+         */
+        void push(const Result<Ok, Err>& result);
+
+        /**
+         * \brief Appends an Ok element
+         * @param value The Ok value
+         */
+        void push_ok(Ok value);
+
+        /**
+         * \brief Appends an Err element
+         * @param error The Err value
+         */
+        void push_err(Err error);
+
+        /**
+         * \brief Rebuilds the Result stored at an index
+         * \note Errors are found by binary search over the error indices
+         * @param index The element index
+         * @return The element as a Result
+         */
+        [[nodiscard]] Result<Ok, Err> get(std::size_t index) const;
+
+        /**
+         * \brief Checks if the element at an index is of type Ok
+         * @param index The element index
+         * @return if the element is of type Ok
+         */
+        [[nodiscard]] inline bool is_ok(std::size_t index) const noexcept {
+            MKTL_DEBUG_ASSERT(index < size(), "ResultBatch index out of range");
+            return (m_Mask[index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1U;
+        }
+
+        /**
+         * \brief Checks if the element at an index is of type Err
+         * @param index The element index
+         * @return if the element is of type Err
+         */
+        [[nodiscard]] inline bool is_err(std::size_t index) const noexcept { return !is_ok(index); }
+
+        [[nodiscard]] inline std::size_t size() const noexcept { return m_Values.size(); }
+        [[nodiscard]] inline bool empty() const noexcept { return m_Values.empty(); }
+
+        /**
+         * \brief Counts the Ok elements with a popcount over the mask
+         * @return The number of Ok elements
+         */
+        [[nodiscard]] std::size_t count_ok() const noexcept;
+
+        /**
+         * \brief Counts the Err elements with a popcount over the mask
+         * @return The number of Err elements
+         */
+        [[nodiscard]] inline std::size_t count_errors() const noexcept { return size() - count_ok(); }
+
+        /**
+         * \brief Maps every Ok element to a U, forwarding errors untouched. func only ever sees Ok values.
+         * \note When both Ok and U are trivially copyable, runs of 64 elements without an error are mapped in a loop
+         * without branches, so the error free common case can still vectorize.
+         * @tparam U New type that's being transformed into
+         * @tparam F The function doing the transforming
+         * @param func The parameter of the function doing the transforming
+         * @return The transformed batch
+         */
+        template<typename U, typename F>
+        ResultBatch<U, Err> map(F&& func) const;
+
+        /**
+         * \brief Like map, but applies func to every slot, error slots included, so the whole loop has no branch.
+         * Error slots hold a value initialized Ok (zero, or a null pointer), so func must be safe to call on that.
+         * @tparam U New type that's being transformed into, must be trivially copyable like Ok
+         * @tparam F The function doing the transforming
+         * @param func The parameter of the function doing the transforming
+         * @return The transformed batch
+         */
+        template<typename U, typename F>
+        ResultBatch<U, Err> map_unchecked(F&& func) const;
+
+        /**
+         * \brief Collects the Ok values, in order
+         * \note Trivially copyable values are compacted without branching
+         * @return The Ok values
+         */
+        std::vector<Ok> filter_ok() const;
+
+        /**
+         * \brief Splits the batch into its Ok values and its errors, both in order
+         * @return The Ok values and the errors
+         */
+        std::pair<std::vector<Ok>, std::vector<Err>> partition() const;
+
+        [[nodiscard]] inline const std::vector<Ok>& values() const noexcept { return m_Values; }
+        [[nodiscard]] inline const std::vector<Err>& errors() const noexcept { return m_Errors; }
+        [[nodiscard]] inline const std::vector<std::size_t>& error_indices() const noexcept { return m_ErrorIndices; }
+        [[nodiscard]] inline const std::vector<std::uint64_t>& mask() const noexcept { return m_Mask; }
+
+    private:
+        template<typename, typename>
+        friend class ResultBatch;
+
+        void push_mask_bit(bool isOk);
+
+        std::vector<Ok> m_Values;
+        std::vector<Err> m_Errors;
+        std::vector<std::size_t> m_ErrorIndices;
+        std::vector<std::uint64_t> m_Mask;
+    };
+
+
+    template<typename Ok, typename Err>
+    ResultBatch<Ok, Err>::ResultBatch(std::size_t capacity){
+        m_Values.reserve(capacity);
+        m_Mask.reserve((capacity + BITS_PER_WORD - 1) / BITS_PER_WORD);
+    }
+
+    template<typename Ok, typename Err>
+    ResultBatch<Ok, Err> ResultBatch<Ok, Err>::from_results(const std::vector<Result<Ok, Err>>& results){
+        ResultBatch<Ok, Err> batch(results.size());
+        for(const Result<Ok, Err>& result : results){
+            batch.push(result);
+        }
+        return batch;
+    }
+
+    template<typename Ok, typename Err>
+    std::vector<Result<Ok, Err>> ResultBatch<Ok, Err>::to_results() const {
+        std::vector<Result<Ok, Err>> results;
+        results.reserve(size());
+
+        // Walk the errors alongside the values instead of searching for each one
+        std::size_t nextError = 0;
+        for(std::size_t i = 0; i < size(); ++i){
+            if(is_ok(i)){
+                results.emplace_back(m_Values[i]);
+            }else{
+                results.emplace_back(m_Errors[nextError++]);
+            }
+        }
+        return results;
+    }
+
+    template<typename Ok, typename Err>
+    void ResultBatch<Ok, Err>::push(const Result<Ok, Err>& result){
+        result.match(
+                [&](const Ok& value){ push_ok(value); },
+                [&](const Err& error){ push_err(error); });
+    }
+
+    template<typename Ok, typename Err>
+    void ResultBatch<Ok, Err>::push_ok(Ok value){
+        m_Values.push_back(std::move(value));
+        push_mask_bit(true);
+    }
+
+    template<typename Ok, typename Err>
+    void ResultBatch<Ok, Err>::push_err(Err error){
+        m_ErrorIndices.push_back(m_Values.size());
+        m_Errors.push_back(std::move(error));
+        m_Values.emplace_back();
+        push_mask_bit(false);
+    }
+
+    template<typename Ok, typename Err>
+    void ResultBatch<Ok, Err>::push_mask_bit(bool isOk){
+        const std::size_t index = m_Values.size() - 1;
+        if(index % BITS_PER_WORD == 0){
+            m_Mask.push_back(0);
+        }
+        m_Mask.back() |= static_cast<std::uint64_t>(isOk) << (index % BITS_PER_WORD);
+    }
+
+    template<typename Ok, typename Err>
+    Result<Ok, Err> ResultBatch<Ok, Err>::get(std::size_t index) const {
+        if(is_ok(index)){
+            return Result<Ok, Err>(m_Values[index]);
+        }
+
+        auto found = std::lower_bound(m_ErrorIndices.begin(), m_ErrorIndices.end(), index);
+        return Result<Ok, Err>(m_Errors[static_cast<std::size_t>(found - m_ErrorIndices.begin())]);
+    }
+
+    template<typename Ok, typename Err>
+    std::size_t ResultBatch<Ok, Err>::count_ok() const noexcept {
+        // bits past size() are never set, so every word can be counted whole
+        std::size_t count = 0;
+        for(std::uint64_t word : m_Mask){
+            count += detail::popcount64(word);
+        }
+        return count;
+    }
+
+    template<typename Ok, typename Err>
+    template<typename U, typename F>
+    ResultBatch<U, Err> ResultBatch<Ok, Err>::map(F&& func) const {
+        ResultBatch<U, Err> mapped;
+        mapped.m_Errors = m_Errors;
+        mapped.m_ErrorIndices = m_ErrorIndices;
+        mapped.m_Mask = m_Mask;
+
+        const std::size_t count = size();
+        if constexpr (std::is_trivially_copyable_v<Ok> && std::is_trivially_copyable_v<U>) {
+            mapped.m_Values.resize(count);
+            const Ok* pIn = m_Values.data();
+            U* pOut = mapped.m_Values.data();
+            for(std::size_t base = 0; base < count; base += BITS_PER_WORD){
+                const std::size_t end = std::min(base + BITS_PER_WORD, count);
+                const std::uint64_t word = m_Mask[base / BITS_PER_WORD];
+                const std::uint64_t allOk = end - base == BITS_PER_WORD ? ~std::uint64_t{0} : (std::uint64_t{1} << (end - base)) - 1;
+
+                if(word == allOk){
+                    for(std::size_t i = base; i < end; ++i){
+                        pOut[i] = func(pIn[i]);
+                    }
+                }else{
+                    for(std::size_t i = base; i < end; ++i){
+                        if((word >> (i - base)) & 1U){
+                            pOut[i] = func(pIn[i]);
+                        }
+                    }
+                }
+            }
+        } else {
+            mapped.m_Values.reserve(count);
+            for(std::size_t i = 0; i < count; ++i){
+                if(is_ok(i)){
+                    mapped.m_Values.push_back(func(m_Values[i]));
+                }else{
+                    mapped.m_Values.emplace_back();
+                }
+            }
+        }
+
+        return mapped;
+    }
+
+    template<typename Ok, typename Err>
+    template<typename U, typename F>
+    ResultBatch<U, Err> ResultBatch<Ok, Err>::map_unchecked(F&& func) const {
+        static_assert(std::is_trivially_copyable_v<Ok> && std::is_trivially_copyable_v<U>,
+                      "map_unchecked needs trivially copyable Ok and U, use map otherwise");
+
+        ResultBatch<U, Err> mapped;
+        mapped.m_Errors = m_Errors;
+        mapped.m_ErrorIndices = m_ErrorIndices;
+        mapped.m_Mask = m_Mask;
+
+        const std::size_t count = size();
+        mapped.m_Values.resize(count);
+        const Ok* pIn = m_Values.data();
+        U* pOut = mapped.m_Values.data();
+        for(std::size_t i = 0; i < count; ++i){
+            pOut[i] = func(pIn[i]);
+        }
+
+        return mapped;
+    }
+
+    template<typename Ok, typename Err>
+    std::vector<Ok> ResultBatch<Ok, Err>::filter_ok() const {
+        std::vector<Ok> okValues;
+        const std::size_t count = size();
+
+        if constexpr (std::is_trivially_copyable_v<Ok>) {
+            // Write every value, but only advance past the Ok ones
+            okValues.resize(count);
+            Ok* pOut = okValues.data();
+            std::size_t written = 0;
+            for(std::size_t i = 0; i < count; ++i){
+                pOut[written] = m_Values[i];
+                written += static_cast<std::size_t>(is_ok(i));
+            }
+            okValues.resize(written);
+        } else {
+            okValues.reserve(count - m_Errors.size());
+            for(std::size_t i = 0; i < count; ++i){
+                if(is_ok(i)){
+                    okValues.push_back(m_Values[i]);
+                }
+            }
+        }
+
+        return okValues;
+    }
+
+    template<typename Ok, typename Err>
+    std::pair<std::vector<Ok>, std::vector<Err>> ResultBatch<Ok, Err>::partition() const {
+        return {filter_ok(), m_Errors};
+    }
+
+}
+
+#endif //MKTL_RESULT_BATCH_HPP
@@ -0,0 +1,333 @@
+/********************************************************************************
+ *  MCKRUEG STL - mckrueg's standard template library of C++ useful stuff       *
+ *  Copyright (C) 2024 Matthew Krueger <contact@matthewkrueger.com>             *
+ *                                                                              *
+ *  This program is free software: you can redistribute it and/or modify        *
+ *  it under the terms of the GNU General Public License as published by        *
+ *  the Free Software Foundation, either version 3 of the License, or           *
+ *  (at your option) any later version.                                         *
+ *                                                                              *
+ *  This program is distributed in the hope that it will be useful,             *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ *  GNU General Public License for more details.                                *
+ *                                                                              *
+ *  You should have received a copy of the GNU General Public License           *
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+ ********************************************************************************/
+
+/*************************************
+ * Coroutine support for Result is
+ * opt in, and requires C++ 20
+ *************************************/
+
+#if __cplusplus < 202002L || !defined(__cpp_impl_coroutine)
+# error MCKRUEG STL Result coroutines require the use of C++ 20 (set MKTL_BUILD_WITH_COROUTINES)
+#endif
+
+// Clang before 17 (Apple Clang before 16) converts get_return_object's result to the declared return type eagerly,
+// before the body runs, so every Result coroutine would panic at runtime. Refuse to build instead.
+#if defined(__clang__) && defined(__apple_build_version__) && __clang_major__ < 16
+# error MCKRUEG STL Result coroutines require Apple Clang 16 or newer
+#elif defined(__clang__) && !defined(__apple_build_version__) && __clang_major__ < 17
+# error MCKRUEG STL Result coroutines require Clang 17 or newer
+#endif
+
+#ifndef MKTL_RESULT_COROUTINE_HPP
+#define MKTL_RESULT_COROUTINE_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+#include "Result.hpp"
+
+// Lets a function returning Result<Ok, Err> be written as a coroutine:
+//
+//     Result<int, Error> parse_and_double(const std::string& text){
+//         int value = co_await parse(text); // returns parse's error from parse_and_double if it failed
+//         co_return value * 2;
+//     }
+//
+// The coroutine runs eagerly and never resumes after an error, so there is no scheduler involved. The return object is
+// converted into the Result only once the body has finished, which is how GCC, MSVC and Clang 17+ handle a
+// get_return_object whose type differs from the declared return type. Older Clang is rejected above.
+
+namespace mckrueg::stl::detail{
+
+    /**
+     * \brief Per-thread cache of coroutine frames.
+     * Frames are bucketed by size in GRANULARITY steps. Freed frames are parked instead of going back to operator new,
+     * so a hot path calling the same coroutines over and over stops allocating after the first call. When the compiler
+     * manages to elide the frame (HALO), none of this is called at all.
+     */
+    class CoroutineFrameCache{
+    public:
+        static constexpr std::size_t GRANULARITY = 64;
+        static constexpr std::size_t BUCKET_COUNT = 16; // frames up to 1 KiB are cached
+        static constexpr std::size_t BUCKET_DEPTH = 8;  // frames kept per bucket
+
+        CoroutineFrameCache() = default;
+        CoroutineFrameCache(const CoroutineFrameCache&) = delete;
+        CoroutineFrameCache& operator=(const CoroutineFrameCache&) = delete;
+
+        /**
+         * \brief Returns every parked frame to the global allocator when the owning thread exits
+         */
+        ~CoroutineFrameCache();
+
+        /**
+         * \brief Allocates a coroutine frame, reusing a parked frame of the same size class if there is one
+         * @param bytes The size of the frame
+         * @return The frame
+         */
+        static void* allocate(std::size_t bytes);
+
+        /**
+         * \brief Parks a coroutine frame for reuse, or frees it if its bucket is full
+         * @param pFrame The frame to release
+         * @param bytes The size of the frame, as passed to allocate
+         */
+        static void deallocate(void* pFrame, std::size_t bytes) noexcept;
+
+    private:
+        struct FreeFrame{
+            FreeFrame* next;
+        };
+
+        static CoroutineFrameCache& local() noexcept;
+
+        FreeFrame* m_Buckets[BUCKET_COUNT]{};
+        std::size_t m_Depth[BUCKET_COUNT]{};
+    };
+
+    template<typename Ok, typename Err>
+    class ResultPromise;
+
+    /**
+     * \brief What get_return_object hands back to the ramp function. Owns the coroutine frame until it is converted to
+     * the Result the coroutine produced.
+     * @tparam Ok The wanted type
+     * @tparam Err The unwanted type
+     */
+    template<typename Ok, typename Err>
+    class ResultReturnObject{
+    public:
+        using Handle = std::coroutine_handle<ResultPromise<Ok, Err>>;
+
+        explicit ResultReturnObject(Handle handle) noexcept;
+        ResultReturnObject(const ResultReturnObject&) = delete;
+        ResultReturnObject(ResultReturnObject&& other) noexcept;
+        ~ResultReturnObject();
+
+        /**
+         * \brief Moves the finished coroutine's Result out of the frame, then destroys the frame
+         * @return The Result produced by co_return, or the error of the first failed co_await
+         */
+        operator Result<Ok, Err>();
+
+    private:
+        friend class ResultPromise<Ok, Err>;
+
+        Handle m_Handle;
+    };
+
+    /**
+     * \brief The promise type of every coroutine returning Result<Ok, Err>
+     * @tparam Ok The wanted type
+     * @tparam Err The unwanted type
+     */
+    template<typename Ok, typename Err>
+    class ResultPromise{
+    public:
+        ResultReturnObject<Ok, Err> get_return_object() noexcept {
+            return ResultReturnObject<Ok, Err>(std::coroutine_handle<ResultPromise>::from_promise(*this));
+        }
+
+        // Run straight away, and stay alive at the end so the return object can read the Result back out
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_always final_suspend() const noexcept { return {}; }
+
+        /**
+         * \brief Handles co_return with either an Ok or an Err value
+         * @param value The value to build the Result from
+         */
+        template<typename U>
+        void return_value(U&& value){ m_Result.emplace(std::forward<U>(value)); }
+
+        /**
+         * \brief Lets an exception leave the coroutine as if it were a normal function
+         * \note The frame is freed by the runtime while the exception unwinds out of the ramp function, so the return
+         * object gives up its ownership first.
+         */
+        void unhandled_exception(){
+            if(m_pReturnObject){
+                m_pReturnObject->m_Handle = nullptr;
+            }
+            throw;
+        }
+
+        static void* operator new(std::size_t bytes){ return CoroutineFrameCache::allocate(bytes); }
+        static void operator delete(void* pFrame, std::size_t bytes) noexcept { CoroutineFrameCache::deallocate(pFrame, bytes); }
+
+    private:
+        friend class ResultReturnObject<Ok, Err>;
+        template<typename, typename, bool>
+        friend struct ResultAwaiter;
+
+        std::optional<Result<Ok, Err>> m_Result;
+        ResultReturnObject<Ok, Err>* m_pReturnObject = nullptr;
+    };
+
+    /**
+     * \brief The awaiter behind co_await on a Result. Resumes with the Ok value, or stores the error in the enclosing
+     * coroutine's promise and leaves the coroutine suspended for good.
+     * \note The awaited Result is held by reference. A temporary operand lives until the end of the full expression,
+     * which outlasts the suspension, so rvalues are moved out of instead of copied.
+     * @tparam Ok The wanted type
+     * @tparam Err The unwanted type
+     * @tparam IsRvalue Whether the awaited Result may be moved out of
+     */
+    template<typename Ok, typename Err, bool IsRvalue>
+    struct ResultAwaiter{
+        using Reference = std::conditional_t<IsRvalue, Result<Ok, Err>&, const Result<Ok, Err>&>;
+        using ResumeType = std::conditional_t<IsRvalue, Ok, const Ok&>;
+
+        Reference result;
+
+        [[nodiscard]] bool await_ready() const noexcept { return result.is_ok(); }
+
+        template<typename OuterOk, typename OuterErr>
+        void await_suspend(std::coroutine_handle<ResultPromise<OuterOk, OuterErr>> handle){
+            if constexpr (IsRvalue) {
+                handle.promise().m_Result.emplace(OuterErr(std::get<Err>(std::move(result.m_Value))));
+            } else {
+                handle.promise().m_Result.emplace(OuterErr(std::get<Err>(result.m_Value)));
+            }
+        }
+
+        ResumeType await_resume(){
+            if constexpr (IsRvalue) {
+                return std::get<Ok>(std::move(result.m_Value));
+            } else {
+                return std::get<Ok>(result.m_Value);
+            }
+        }
+    };
+
+
+    inline CoroutineFrameCache::~CoroutineFrameCache(){
+        for(FreeFrame*& head : m_Buckets){
+            while(head){
+                FreeFrame* next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+    }
+
+    inline CoroutineFrameCache& CoroutineFrameCache::local() noexcept {
+        thread_local CoroutineFrameCache cache;
+        return cache;
+    }
+
+    inline void* CoroutineFrameCache::allocate(std::size_t bytes){
+        const std::size_t bucket = (bytes - 1) / GRANULARITY;
+        if(bucket >= BUCKET_COUNT){
+            return ::operator new(bytes);
+        }
+
+        CoroutineFrameCache& cache = local();
+        if(FreeFrame* frame = cache.m_Buckets[bucket]){
+            cache.m_Buckets[bucket] = frame->next;
+            --cache.m_Depth[bucket];
+            return frame;
+        }
+
+        // round up so every frame in a bucket can serve any request in that bucket
+        return ::operator new((bucket + 1) * GRANULARITY);
+    }
+
+    inline void CoroutineFrameCache::deallocate(void* pFrame, std::size_t bytes) noexcept {
+        const std::size_t bucket = (bytes - 1) / GRANULARITY;
+        if(bucket >= BUCKET_COUNT){
+            ::operator delete(pFrame);
+            return;
+        }
+
+        CoroutineFrameCache& cache = local();
+        if(cache.m_Depth[bucket] == BUCKET_DEPTH){
+            ::operator delete(pFrame);
+            return;
+        }
+
+        auto* frame = static_cast<FreeFrame*>(pFrame);
+        frame->next = cache.m_Buckets[bucket];
+        cache.m_Buckets[bucket] = frame;
+        ++cache.m_Depth[bucket];
+    }
+
+    template<typename Ok, typename Err>
+    ResultReturnObject<Ok, Err>::ResultReturnObject(Handle handle) noexcept : m_Handle(handle){
+        m_Handle.promise().m_pReturnObject = this;
+    }
+
+    template<typename Ok, typename Err>
+    ResultReturnObject<Ok, Err>::ResultReturnObject(ResultReturnObject&& other) noexcept
+            : m_Handle(std::exchange(other.m_Handle, nullptr)){
+        if(m_Handle){
+            m_Handle.promise().m_pReturnObject = this;
+        }
+    }
+
+    template<typename Ok, typename Err>
+    ResultReturnObject<Ok, Err>::~ResultReturnObject(){
+        if(m_Handle){
+            m_Handle.destroy();
+        }
+    }
+
+    template<typename Ok, typename Err>
+    ResultReturnObject<Ok, Err>::operator Result<Ok, Err>(){
+        Handle handle = std::exchange(m_Handle, nullptr);
+        ResultPromise<Ok, Err>& promise = handle.promise();
+
+        if(!promise.m_Result){
+            handle.destroy();
+            panic("Result coroutine finished without producing a Result");
+        }
+
+        Result<Ok, Err> result(std::move(*promise.m_Result));
+        handle.destroy();
+        return result;
+    }
+
+}
+
+namespace mckrueg::stl{
+
+    /**
+     * \brief Unwraps a Result inside a Result coroutine, or returns its error from the coroutine
+     * @param result The Result to unwrap
+     * @return An awaiter resuming with a reference to the Ok value
+     */
+    template<typename Ok, typename Err>
+    detail::ResultAwaiter<Ok, Err, false> operator co_await(const Result<Ok, Err>& result) noexcept { return {result}; }
+
+    /**
+     * \brief Unwraps a temporary Result inside a Result coroutine, or returns its error from the coroutine
+     * @param result The Result to unwrap
+     * @return An awaiter resuming with the Ok value moved out of the Result
+     */
+    template<typename Ok, typename Err>
+    detail::ResultAwaiter<Ok, Err, true> operator co_await(Result<Ok, Err>&& result) noexcept { return {result}; }
+
+}
+
+template<typename Ok, typename Err, typename... Args>
+struct std::coroutine_traits<mckrueg::stl::Result<Ok, Err>, Args...>{
+    using promise_type = mckrueg::stl::detail::ResultPromise<Ok, Err>;
+};
+
+#endif //MKTL_RESULT_COROUTINE_HPP
@@ -0,0 +1,160 @@
+/********************************************************************************
+ *  MCKRUEG STL - mckrueg's standard template library of C++ useful stuff       *
+ *  Copyright (C) 2024 Matthew Krueger <contact@matthewkrueger.com>             *
+ *                                                                              *
+ *  This program is free software: you can redistribute it and/or modify        *
+ *  it under the terms of the GNU General Public License as published by        *
+ *  the Free Software Foundation, either version 3 of the License, or           *
+ *  (at your option) any later version.                                         *
+ *                                                                              *
+ *  This program is distributed in the hope that it will be useful,             *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ *  GNU General Public License for more details.                                *
+ *                                                                              *
+ *  You should have received a copy of the GNU General Public License           *
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+ ********************************************************************************/
+
+/*************************************
+ * The mckrueg stl requires
+ * C++ 17
+ *************************************/
+
+#if __cplusplus < 201703L
+# error MCKRUEG STL requires the use of C++ 17
+#endif
+
+#ifndef MKTL_SMALL_STRING_HPP
+#define MKTL_SMALL_STRING_HPP
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "SmallVector.hpp"
+
+namespace mckrueg::stl{
+
+    /**
+     * \brief A string that keeps up to N characters inside the object, built on SmallVector.
+     * Always null terminated, so c_str() is free. Spills to the heap are counted the same way as SmallVector's.
+     * @tparam N How many characters fit inline, not counting the terminator
+     */
+    template<std::size_t N = 23>
+    class SmallString{
+    public:
+        SmallString(){ m_Characters.push_back('\0'); }
+        SmallString(std::string_view text){ assign(text); }
+        SmallString(const char* text) : SmallString(std::string_view(text)){}
+        SmallString(const std::string& text) : SmallString(std::string_view(text)){}
+
+        SmallString(const SmallString& other) = default;
+        SmallString& operator=(const SmallString& other) = default;
+
+        // A moved from SmallVector is empty and inline, so putting the terminator back never allocates
+        SmallString(SmallString&& other) noexcept : m_Characters(std::move(other.m_Characters)){
+            other.m_Characters.push_back('\0');
+        }
+        SmallString& operator=(SmallString&& other) noexcept {
+            if(this != &other){
+                m_Characters = std::move(other.m_Characters);
+                other.m_Characters.push_back('\0');
+            }
+            return *this;
+        }
+
+        [[nodiscard]] inline std::size_t size() const noexcept { return m_Characters.size() - 1; }
+        [[nodiscard]] inline bool empty() const noexcept { return size() == 0; }
+        [[nodiscard]] inline bool is_inline() const noexcept { return m_Characters.is_inline(); }
+
+        [[nodiscard]] inline const char* c_str() const noexcept { return m_Characters.data(); }
+        [[nodiscard]] inline const char* data() const noexcept { return m_Characters.data(); }
+        [[nodiscard]] inline char* data() noexcept { return m_Characters.data(); }
+
+        inline char& operator[](std::size_t index) noexcept { return m_Characters[index]; }
+        inline const char& operator[](std::size_t index) const noexcept { return m_Characters[index]; }
+
+        inline const char* begin() const noexcept { return m_Characters.begin(); }
+        inline const char* end() const noexcept { return m_Characters.end() - 1; }
+
+        inline operator std::string_view() const noexcept { return {data(), size()}; }
+        [[nodiscard]] inline std::string str() const { return {data(), size()}; }
+
+        /**
+         * \brief Replaces the contents
+         * @param text The new contents
+         */
+        void assign(std::string_view text);
+
+        /**
+         * \brief Appends text to the end
+         * @param text The text to append
+         * @return This string
+         */
+        SmallString& append(std::string_view text);
+
+        void push_back(char character);
+        void clear() noexcept;
+        void reserve(std::size_t characters){ m_Characters.reserve(characters + 1); }
+
+        inline SmallString& operator+=(std::string_view text){ return append(text); }
+        inline SmallString& operator+=(char character){ push_back(character); return *this; }
+
+        inline friend bool operator==(const SmallString& lhs, std::string_view rhs) noexcept { return std::string_view(lhs) == rhs; }
+        inline friend bool operator!=(const SmallString& lhs, std::string_view rhs) noexcept { return std::string_view(lhs) != rhs; }
+
+        inline friend std::ostream& operator<<(std::ostream& os, const SmallString& rhs) { return os << std::string_view(rhs); }
+
+    private:
+        SmallVector<char, N + 1> m_Characters;
+    };
+
+
+    template<std::size_t N>
+    void SmallString<N>::assign(std::string_view text){
+        m_Characters.clear();
+        m_Characters.reserve(text.size() + 1);
+        for(char character : text){
+            m_Characters.push_back(character);
+        }
+        m_Characters.push_back('\0');
+    }
+
+    template<std::size_t N>
+    SmallString<N>& SmallString<N>::append(std::string_view text){
+        // text may point into this string, reserve could free it, so find it again by offset afterwards
+        const std::less_equal<const char*> notAfter;
+        const bool aliases = notAfter(data(), text.data()) && notAfter(text.data(), data() + size());
+        const std::size_t offset = aliases ? static_cast<std::size_t>(text.data() - data()) : 0;
+
+        m_Characters.pop_back();
+        m_Characters.reserve(m_Characters.size() + text.size() + 1);
+        if(aliases){
+            text = std::string_view(data() + offset, text.size());
+        }
+
+        for(char character : text){
+            m_Characters.push_back(character);
+        }
+        m_Characters.push_back('\0');
+        return *this;
+    }
+
+    template<std::size_t N>
+    void SmallString<N>::push_back(char character){
+        m_Characters.back() = character;
+        m_Characters.push_back('\0');
+    }
+
+    template<std::size_t N>
+    void SmallString<N>::clear() noexcept {
+        m_Characters.clear();
+        m_Characters.push_back('\0');
+    }
+
+}
+
+#endif //MKTL_SMALL_STRING_HPP
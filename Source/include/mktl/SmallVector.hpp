@@ -0,0 +1,429 @@
+/********************************************************************************
+ *  MCKRUEG STL - mckrueg's standard template library of C++ useful stuff       *
+ *  Copyright (C) 2024 Matthew Krueger <contact@matthewkrueger.com>             *
+ *                                                                              *
+ *  This program is free software: you can redistribute it and/or modify        *
+ *  it under the terms of the GNU General Public License as published by        *
+ *  the Free Software Foundation, either version 3 of the License, or           *
+ *  (at your option) any later version.                                         *
+ *                                                                              *
+ *  This program is distributed in the hope that it will be useful,             *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ *  GNU General Public License for more details.                                *
+ *                                                                              *
+ *  You should have received a copy of the GNU General Public License           *
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+ ********************************************************************************/
+
+/*************************************
+ * The mckrueg stl requires
+ * C++ 17
+ *************************************/
+
+#if __cplusplus < 201703L
+# error MCKRUEG STL requires the use of C++ 17
+#endif
+
+#ifndef MKTL_SMALL_VECTOR_HPP
+#define MKTL_SMALL_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <mktl_c/Memory.h>
+
+#include "Traps.hpp"
+
+namespace mckrueg::stl{
+
+    /**
+     * \brief Whether a T can be moved to a new address with memcpy, leaving nothing to destroy at the old one.
+     * Defaults to trivially copyable types. Specialize it for types that are safe to relocate but not trivially
+     * copyable, such as std::unique_ptr or most types holding only a pointer to the heap.
+     * @tparam T The type to check
+     */
+    template<typename T>
+    struct is_trivially_relocatable : std::is_trivially_copyable<T>{};
+
+    template<typename T>
+    inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+    /**
+     * \brief A vector that keeps up to N elements inside the object and only goes to the heap past that.
+     * Heap allocations go through the global operator new, and every move from inline storage to the heap is counted
+     * by recordInlineSpill() in Memory.h, so N can be tuned from real numbers.
+     * \note Moving a SmallVector that is still inline moves its elements one by one, or with memcpy for trivially
+     * relocatable types. Moving one that has spilled just steals the heap buffer.
+     * @tparam T The element type
+     * @tparam N How many elements fit inline
+     */
+    template<typename T, std::size_t N>
+    class SmallVector{
+        static_assert(N > 0, "SmallVector needs room for at least one inline element");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Over aligned elements are not supported");
+
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        SmallVector() noexcept = default;
+        SmallVector(std::size_t count, const T& value);
+        SmallVector(std::initializer_list<T> values);
+
+        template<typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        SmallVector(InputIt first, InputIt last);
+
+        SmallVector(const SmallVector& other);
+        SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>);
+        SmallVector& operator=(const SmallVector& other);
+        SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>);
+        ~SmallVector();
+
+        [[nodiscard]] inline T* data() noexcept { return m_pData; }
+        [[nodiscard]] inline const T* data() const noexcept { return m_pData; }
+        [[nodiscard]] inline std::size_t size() const noexcept { return m_Size; }
+        [[nodiscard]] inline std::size_t capacity() const noexcept { return m_Capacity; }
+        [[nodiscard]] inline bool empty() const noexcept { return m_Size == 0; }
+
+        /**
+         * \brief Checks if the elements still live inside the object
+         * @return if no heap memory is in use
+         */
+        [[nodiscard]] inline bool is_inline() const noexcept { return m_pData == inline_data(); }
+
+        inline T& operator[](std::size_t index) noexcept {
+            MKTL_DEBUG_ASSERT(index < m_Size, "SmallVector index out of range");
+            return m_pData[index];
+        }
+        inline const T& operator[](std::size_t index) const noexcept {
+            MKTL_DEBUG_ASSERT(index < m_Size, "SmallVector index out of range");
+            return m_pData[index];
+        }
+        inline T& front() noexcept { MKTL_DEBUG_ASSERT(m_Size > 0, "front() on an empty SmallVector"); return m_pData[0]; }
+        inline const T& front() const noexcept { MKTL_DEBUG_ASSERT(m_Size > 0, "front() on an empty SmallVector"); return m_pData[0]; }
+        inline T& back() noexcept { MKTL_DEBUG_ASSERT(m_Size > 0, "back() on an empty SmallVector"); return m_pData[m_Size - 1]; }
+        inline const T& back() const noexcept { MKTL_DEBUG_ASSERT(m_Size > 0, "back() on an empty SmallVector"); return m_pData[m_Size - 1]; }
+
+        inline iterator begin() noexcept { return m_pData; }
+        inline iterator end() noexcept { return m_pData + m_Size; }
+        inline const_iterator begin() const noexcept { return m_pData; }
+        inline const_iterator end() const noexcept { return m_pData + m_Size; }
+
+        /**
+         * \brief Makes room for at least capacity elements, spilling to the heap if that is more than N
+         * @param capacity The wanted capacity
+         */
+        void reserve(std::size_t capacity);
+
+        void push_back(const T& value){ emplace_back(value); }
+        void push_back(T&& value){ emplace_back(std::move(value)); }
+
+        template<typename... Args>
+        T& emplace_back(Args&&... args);
+
+        void pop_back() noexcept;
+        void clear() noexcept;
+
+        void resize(std::size_t count);
+        void resize(std::size_t count, const T& value);
+
+        /**
+         * \brief Removes one element, shifting the rest down
+         * @param position The element to remove
+         * @return An iterator to the element after the removed one
+         */
+        iterator erase(const_iterator position);
+
+        bool operator==(const SmallVector& rhs) const;
+        inline bool operator!=(const SmallVector& rhs) const { return !(*this == rhs); }
+
+    private:
+        inline T* inline_data() noexcept { return reinterpret_cast<T*>(m_InlineStorage); }
+        inline const T* inline_data() const noexcept { return reinterpret_cast<const T*>(m_InlineStorage); }
+
+        T* allocate_for_growth(std::size_t capacity);
+        void grow_to(std::size_t capacity);
+        void adopt(T* pNewData, std::size_t capacity) noexcept;
+        void release_heap() noexcept;
+        void take_from(SmallVector&& other);
+
+        template<typename... Args>
+        T& grow_and_emplace_back(Args&&... args);
+
+        static void relocate(T* pFrom, T* pTo, std::size_t count);
+        static void relocate_for_growth(T* pFrom, T* pTo, std::size_t count);
+
+        T* m_pData = inline_data();
+        std::size_t m_Size = 0;
+        std::size_t m_Capacity = N;
+        alignas(T) unsigned char m_InlineStorage[N * sizeof(T)];
+    };
+
+
+    template<typename T, std::size_t N>
+    SmallVector<T, N>::SmallVector(std::size_t count, const T& value){
+        resize(count, value);
+    }
+
+    template<typename T, std::size_t N>
+    SmallVector<T, N>::SmallVector(std::initializer_list<T> values) : SmallVector(values.begin(), values.end()){}
+
+    template<typename T, std::size_t N>
+    template<typename InputIt, typename>
+    SmallVector<T, N>::SmallVector(InputIt first, InputIt last){
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>) {
+            reserve(static_cast<std::size_t>(std::distance(first, last)));
+        }
+        for(; first != last; ++first){
+            emplace_back(*first);
+        }
+    }
+
+    template<typename T, std::size_t N>
+    SmallVector<T, N>::SmallVector(const SmallVector& other) : SmallVector(other.begin(), other.end()){}
+
+    template<typename T, std::size_t N>
+    SmallVector<T, N>::SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>){
+        take_from(std::move(other));
+    }
+
+    template<typename T, std::size_t N>
+    SmallVector<T, N>& SmallVector<T, N>::operator=(const SmallVector& other){
+        if(this != &other){
+            clear();
+            reserve(other.size());
+            for(const T& value : other){
+                emplace_back(value);
+            }
+        }
+        return *this;
+    }
+
+    template<typename T, std::size_t N>
+    SmallVector<T, N>& SmallVector<T, N>::operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>){
+        if(this != &other){
+            clear();
+            release_heap();
+            take_from(std::move(other));
+        }
+        return *this;
+    }
+
+    template<typename T, std::size_t N>
+    SmallVector<T, N>::~SmallVector(){
+        clear();
+        release_heap();
+    }
+
+    template<typename T, std::size_t N>
+    void SmallVector<T, N>::take_from(SmallVector&& other){
+        // Expects this to be empty and inline
+        if(!other.is_inline()){
+            m_pData = other.m_pData;
+            m_Size = other.m_Size;
+            m_Capacity = other.m_Capacity;
+        }else{
+            relocate(other.m_pData, m_pData, other.m_Size);
+            m_Size = other.m_Size;
+        }
+
+        other.m_pData = other.inline_data();
+        other.m_Size = 0;
+        other.m_Capacity = N;
+    }
+
+    template<typename T, std::size_t N>
+    void SmallVector<T, N>::relocate(T* pFrom, T* pTo, std::size_t count){
+        if constexpr (is_trivially_relocatable_v<T>) {
+            if(count){
+                std::memcpy(static_cast<void*>(pTo), static_cast<const void*>(pFrom), count * sizeof(T));
+            }
+        } else {
+            for(std::size_t i = 0; i < count; ++i){
+                new (pTo + i) T(std::move(pFrom[i]));
+                pFrom[i].~T();
+            }
+        }
+    }
+
+    template<typename T, std::size_t N>
+    void SmallVector<T, N>::relocate_for_growth(T* pFrom, T* pTo, std::size_t count){
+        // Strong guarantee: if a move or copy throws, pTo is cleaned up and pFrom is left as it was
+        if constexpr (is_trivially_relocatable_v<T>) {
+            if(count){
+                std::memcpy(static_cast<void*>(pTo), static_cast<const void*>(pFrom), count * sizeof(T));
+            }
+        } else {
+            std::size_t constructed = 0;
+            try{
+                for(; constructed < count; ++constructed){
+                    new (pTo + constructed) T(std::move_if_noexcept(pFrom[constructed]));
+                }
+            }catch(...){
+                std::destroy(pTo, pTo + constructed);
+                throw;
+            }
+            std::destroy(pFrom, pFrom + count);
+        }
+    }
+
+    template<typename T, std::size_t N>
+    T* SmallVector<T, N>::allocate_for_growth(std::size_t capacity){
+        const std::size_t bytes = capacity * sizeof(T);
+        T* pNewData = static_cast<T*>(::operator new(bytes));
+        if(is_inline()){
+            recordInlineSpill(static_cast<unsigned long>(bytes));
+        }else{
+            recordInlineRegrowth(static_cast<unsigned long>(bytes));
+        }
+        return pNewData;
+    }
+
+    template<typename T, std::size_t N>
+    void SmallVector<T, N>::adopt(T* pNewData, std::size_t capacity) noexcept {
+        release_heap();
+        m_pData = pNewData;
+        m_Capacity = capacity;
+    }
+
+    template<typename T, std::size_t N>
+    void SmallVector<T, N>::grow_to(std::size_t capacity){
+        T* pNewData = allocate_for_growth(capacity);
+        try{
+            relocate_for_growth(m_pData, pNewData, m_Size);
+        }catch(...){
+            ::operator delete(pNewData);
+            throw;
+        }
+        adopt(pNewData, capacity);
+    }
+
+    template<typename T, std::size_t N>
+    void SmallVector<T, N>::release_heap() noexcept {
+        if(!is_inline()){
+            ::operator delete(m_pData);
+            m_pData = inline_data();
+            m_Capacity = N;
+        }
+    }
+
+    template<typename T, std::size_t N>
+    void SmallVector<T, N>::reserve(std::size_t capacity){
+        if(capacity > m_Capacity){
+            grow_to(capacity);
+        }
+    }
+
+    template<typename T, std::size_t N>
+    template<typename... Args>
+    T& SmallVector<T, N>::emplace_back(Args&&... args){
+        if(m_Size == m_Capacity){
+            return grow_and_emplace_back(std::forward<Args>(args)...);
+        }
+        T* pValue = new (m_pData + m_Size) T(std::forward<Args>(args)...);
+        ++m_Size;
+        return *pValue;
+    }
+
+    template<typename T, std::size_t N>
+    template<typename... Args>
+    T& SmallVector<T, N>::grow_and_emplace_back(Args&&... args){
+        // args may refer to an element of this vector, so the new element is built before the old ones move
+        const std::size_t capacity = m_Capacity * 2;
+        T* pNewData = allocate_for_growth(capacity);
+
+        T* pValue;
+        try{
+            pValue = new (pNewData + m_Size) T(std::forward<Args>(args)...);
+        }catch(...){
+            ::operator delete(pNewData);
+            throw;
+        }
+
+        try{
+            relocate_for_growth(m_pData, pNewData, m_Size);
+        }catch(...){
+            pValue->~T();
+            ::operator delete(pNewData);
+            throw;
+        }
+
+        adopt(pNewData, capacity);
+        ++m_Size;
+        return *pValue;
+    }
+
+    template<typename T, std::size_t N>
+    void SmallVector<T, N>::pop_back() noexcept {
+        MKTL_DEBUG_ASSERT(m_Size > 0, "pop_back() on an empty SmallVector");
+        --m_Size;
+        m_pData[m_Size].~T();
+    }
+
+    template<typename T, std::size_t N>
+    void SmallVector<T, N>::clear() noexcept {
+        std::destroy(m_pData, m_pData + m_Size);
+        m_Size = 0;
+    }
+
+    template<typename T, std::size_t N>
+    void SmallVector<T, N>::resize(std::size_t count){
+        if(count < m_Size){
+            std::destroy(m_pData + count, m_pData + m_Size);
+            m_Size = count;
+            return;
+        }
+        reserve(count);
+        for(; m_Size < count; ++m_Size){
+            new (m_pData + m_Size) T();
+        }
+    }
+
+    template<typename T, std::size_t N>
+    void SmallVector<T, N>::resize(std::size_t count, const T& value){
+        if(count < m_Size){
+            std::destroy(m_pData + count, m_pData + m_Size);
+            m_Size = count;
+            return;
+        }
+        if(count > m_Capacity){
+            // value may be an element of this vector, copy it before growing frees it
+            const T copy(value);
+            reserve(count);
+            resize(count, copy);
+            return;
+        }
+        for(; m_Size < count; ++m_Size){
+            new (m_pData + m_Size) T(value);
+        }
+    }
+
+    template<typename T, std::size_t N>
+    typename SmallVector<T, N>::iterator SmallVector<T, N>::erase(const_iterator position){
+        auto index = static_cast<std::size_t>(position - m_pData);
+        MKTL_DEBUG_ASSERT(index < m_Size, "SmallVector::erase position out of range");
+        std::move(m_pData + index + 1, m_pData + m_Size, m_pData + index);
+        pop_back();
+        return m_pData + index;
+    }
+
+    template<typename T, std::size_t N>
+    bool SmallVector<T, N>::operator==(const SmallVector& rhs) const {
+        return m_Size == rhs.m_Size && std::equal(begin(), end(), rhs.begin());
+    }
+
+}
+
+#endif //MKTL_SMALL_VECTOR_HPP
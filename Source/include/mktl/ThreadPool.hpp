@@ -0,0 +1,339 @@
+/********************************************************************************
+ *  MCKRUEG STL - mckrueg's standard template library of C++ useful stuff       *
+ *  Copyright (C) 2024 Matthew Krueger <contact@matthewkrueger.com>             *
+ *                                                                              *
+ *  This program is free software: you can redistribute it and/or modify        *
+ *  it under the terms of the GNU General Public License as published by        *
+ *  the Free Software Foundation, either version 3 of the License, or           *
+ *  (at your option) any later version.                                         *
+ *                                                                              *
+ *  This program is distributed in the hope that it will be useful,             *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ *  GNU General Public License for more details.                                *
+ *                                                                              *
+ *  You should have received a copy of the GNU General Public License           *
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+ ********************************************************************************/
+
+/*************************************
+ * The mckrueg stl requires
+ * C++ 17
+ *************************************/
+
+#if __cplusplus < 201703L
+# error MCKRUEG STL requires the use of C++ 17
+#endif
+
+#ifndef MKTL_THREAD_POOL_HPP
+#define MKTL_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <mktl_c/internal/mktl_shared_library_exports.h>
+#include "Result.hpp"
+#include "WorkStealingDeque.hpp"
+
+namespace mckrueg::stl{
+
+    /**
+     * \brief A per-thread block allocator for small, short lived objects such as tasks.
+     * Blocks come in a few power of two size classes carved out of slabs. The owning thread allocates and frees
+     * without any synchronization. Any other thread freeing a block pushes it onto a lock-free list that the owner
+     * takes back the next time it runs dry. Counters are reported through getArenaStats() in Memory.h.
+     * \note A thread that is not bound to an arena falls back to operator new, so allocate and deallocate are safe to
+     * call from anywhere.
+     */
+    class __MKTL_API WorkerArena{
+    public:
+        static constexpr std::size_t SIZE_CLASS_COUNT = 4;
+        static constexpr std::size_t SMALLEST_BLOCK = 64; // size classes are 64, 128, 256 and 512 bytes
+        static constexpr std::size_t SLAB_SIZE = 64 * 1024;
+
+        WorkerArena();
+        WorkerArena(const WorkerArena&) = delete;
+        WorkerArena& operator=(const WorkerArena&) = delete;
+
+        /**
+         * \brief Returns the slabs to the global allocator.
+         * \note Every block must have been freed by now
+         */
+        ~WorkerArena();
+
+        /**
+         * \brief Allocates from the calling thread's arena, or from operator new if there is none
+         * \note Blocks are aligned to alignof(std::max_align_t)
+         * @param bytes The size to allocate
+         * @return The allocation
+         */
+        static void* allocate(std::size_t bytes);
+
+        /**
+         * \brief Frees a block from allocate, returning it to whichever arena owns it
+         * @param pBlock The block to free
+         */
+        static void deallocate(void* pBlock) noexcept;
+
+        /**
+         * \brief Makes an arena the calling thread's arena
+         * @param pArena The arena, or nullptr to unbind
+         */
+        static void bind(WorkerArena* pArena) noexcept;
+
+        /**
+         * \brief Gets the calling thread's arena
+         * @return The arena, or nullptr if none is bound
+         */
+        static WorkerArena* current() noexcept;
+
+    private:
+        friend struct ArenaRegistry;
+
+        struct alignas(std::max_align_t) BlockHeader{
+            WorkerArena* pOwner;
+            std::size_t sizeClass;
+        };
+
+        struct FreeBlock{
+            FreeBlock* next;
+        };
+
+        void* allocate_block(std::size_t sizeClass);
+        void free_block(BlockHeader* pHeader) noexcept;
+
+        FreeBlock* m_FreeLists[SIZE_CLASS_COUNT]{};
+        unsigned char* m_pCursor = nullptr;
+        unsigned char* m_pEnd = nullptr;
+        std::vector<void*> m_Slabs;
+
+        // Only the owner writes these, but stats are read from other threads
+        std::atomic<unsigned long long> m_BytesReserved{0};
+        std::atomic<unsigned long long> m_AllocationCount{0};
+        std::atomic<unsigned long long> m_DeallocationCount{0};
+
+        // Written by every other thread, so keep it away from the owner's fields
+        alignas(64) std::atomic<FreeBlock*> m_RemoteFrees[SIZE_CLASS_COUNT]{};
+        std::atomic<unsigned long long> m_RemoteDeallocationCount{0};
+    };
+
+    namespace detail{
+
+        /**
+         * \brief A type erased unit of work. Runs once, then destroys and frees itself.
+         */
+        struct Task{
+            void (*pExecute)(Task*);
+        };
+
+        template<typename F>
+        struct FunctionTask : Task{
+            explicit FunctionTask(F&& function) : func(std::move(function)){ pExecute = &execute; }
+
+            static void execute(Task* pTask){
+                auto* pSelf = static_cast<FunctionTask*>(pTask);
+                pSelf->func();
+                pSelf->~FunctionTask();
+                WorkerArena::deallocate(pSelf);
+            }
+
+            F func;
+        };
+
+        template<typename R>
+        struct ResultTraits;
+
+        template<typename Ok, typename Err>
+        struct ResultTraits<Result<Ok, Err>>{
+            using OkType = Ok;
+            using ErrType = Err;
+        };
+
+        /**
+         * \brief The state shared between a task and its future
+         */
+        template<typename Ok, typename Err>
+        struct FutureState{
+            std::atomic<bool> ready{false};
+            std::optional<Result<Ok, Err>> result;
+            std::mutex mutex;
+            std::condition_variable condition;
+        };
+
+    }
+
+    class ThreadPool;
+
+    /**
+     * \brief The eventual Result of a task spawned on a ThreadPool
+     * @tparam Ok The wanted type
+     * @tparam Err The unwanted type
+     */
+    template<typename Ok, typename Err>
+    class TaskFuture{
+    public:
+        TaskFuture(std::shared_ptr<detail::FutureState<Ok, Err>> pState, ThreadPool* pPool)
+                : m_pState(std::move(pState)), m_pPool(pPool){}
+
+        /**
+         * \brief Checks if the task has finished
+         * @return if the Result is available
+         */
+        [[nodiscard]] inline bool is_ready() const noexcept { return m_pState->ready.load(std::memory_order_acquire); }
+
+        /**
+         * \brief Blocks until the task has finished
+         * \note A worker of the same pool runs other queued tasks while it waits instead of blocking
+         */
+        void wait() const;
+
+        /**
+         * \brief Waits for the task, then returns its Result
+         * @return The Result the task produced
+         */
+        Result<Ok, Err> get() const;
+
+    private:
+        std::shared_ptr<detail::FutureState<Ok, Err>> m_pState;
+        ThreadPool* m_pPool;
+    };
+
+    /**
+     * \brief A work stealing thread pool.
+     * Every worker owns a Chase-Lev deque and a WorkerArena. Tasks spawned from a worker go onto its own deque and are
+     * allocated from its arena. Tasks spawned from any other thread go through a shared injection queue. A worker
+     * with nothing to do tries to steal from the others, then parks on a condition variable instead of spinning.
+     * \note Tasks must not throw. An exception leaving a task terminates the program, as it would on a std::thread.
+     */
+    class __MKTL_API ThreadPool{
+    public:
+        /**
+         * \brief Starts the workers
+         * @param workerCount How many workers to start, defaults to one per hardware thread
+         */
+        explicit ThreadPool(std::size_t workerCount = std::thread::hardware_concurrency());
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * \brief Runs every task still queued, then joins the workers
+         */
+        ~ThreadPool();
+
+        /**
+         * \brief Runs a fallible function on the pool
+         * @tparam F The function, F() -> Result<Ok, Err>
+         * @param func The function
+         * @return A future for the function's Result
+         */
+        template<typename F>
+        auto spawn(F&& func);
+
+        /**
+         * \brief Runs a function on the pool without a way to wait for it
+         * @tparam F The function, F() -> void
+         * @param func The function
+         */
+        template<typename F>
+        void execute(F&& func);
+
+        /**
+         * \brief Runs one queued task on the calling thread if it is one of this pool's workers
+         * @return if a task was run
+         */
+        bool run_pending_task();
+
+        [[nodiscard]] inline std::size_t worker_count() const noexcept { return m_Workers.size(); }
+
+        /**
+         * \brief Checks if the calling thread is one of this pool's workers
+         * @return if the calling thread is a worker of this pool
+         */
+        [[nodiscard]] bool is_worker_thread() const noexcept;
+
+    private:
+        struct Worker;
+
+        void submit(detail::Task* pTask);
+        detail::Task* find_task(std::size_t self);
+        void worker_main(std::size_t self);
+
+        std::vector<std::unique_ptr<Worker>> m_Workers;
+
+        std::mutex m_InjectionMutex;
+        std::deque<detail::Task*> m_Injected;
+
+        alignas(64) std::atomic<std::size_t> m_QueuedTasks{0};
+        alignas(64) std::atomic<std::size_t> m_Sleepers{0};
+        std::mutex m_ParkMutex;
+        std::condition_variable m_ParkCondition;
+        std::atomic<bool> m_Stopping{false};
+    };
+
+
+    template<typename Ok, typename Err>
+    void TaskFuture<Ok, Err>::wait() const {
+        if(is_ready()) return;
+
+        if(m_pPool && m_pPool->is_worker_thread()){
+            // Blocking a worker here could deadlock the pool, so keep it busy instead
+            while(!is_ready()){
+                if(!m_pPool->run_pending_task()){
+                    std::this_thread::yield();
+                }
+            }
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(m_pState->mutex);
+        m_pState->condition.wait(lock, [this]{ return is_ready(); });
+    }
+
+    template<typename Ok, typename Err>
+    Result<Ok, Err> TaskFuture<Ok, Err>::get() const {
+        wait();
+        return *m_pState->result;
+    }
+
+    template<typename F>
+    auto ThreadPool::spawn(F&& func){
+        using ResultType = std::invoke_result_t<std::decay_t<F>&>;
+        using Ok = typename detail::ResultTraits<ResultType>::OkType;
+        using Err = typename detail::ResultTraits<ResultType>::ErrType;
+
+        auto pState = std::make_shared<detail::FutureState<Ok, Err>>();
+        execute([pState, function = std::forward<F>(func)]() mutable {
+            pState->result.emplace(function());
+            {
+                // publish under the lock so a waiter cannot miss the notification
+                std::lock_guard<std::mutex> lock(pState->mutex);
+                pState->ready.store(true, std::memory_order_release);
+            }
+            pState->condition.notify_all();
+        });
+
+        return TaskFuture<Ok, Err>(std::move(pState), this);
+    }
+
+    template<typename F>
+    void ThreadPool::execute(F&& func){
+        using TaskType = detail::FunctionTask<std::decay_t<F>>;
+        static_assert(alignof(TaskType) <= alignof(std::max_align_t), "Over aligned tasks are not supported");
+
+        void* pMemory = WorkerArena::allocate(sizeof(TaskType));
+        submit(new (pMemory) TaskType(std::decay_t<F>(std::forward<F>(func))));
+    }
+
+}
+
+#endif //MKTL_THREAD_POOL_HPP
@@ -62,4 +62,122 @@ static inline void MKTL_DEBUG_BREAK(void) { __asm__ __volatile__(".inst 0xe7f001
 #  endif
 #endif
 
+/*************************************
+ * Branch hints and assumptions
+ *************************************/
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define MKTL_LIKELY(condition) __builtin_expect(!!(condition), 1)
+#  define MKTL_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#  define MKTL_COLD __attribute__((cold, noinline))
+#  define MKTL_UNREACHABLE() __builtin_unreachable()
+#elif defined(_MSC_VER)
+#  define MKTL_LIKELY(condition) (!!(condition))
+#  define MKTL_UNLIKELY(condition) (!!(condition))
+#  define MKTL_COLD __declspec(noinline)
+#  define MKTL_UNREACHABLE() __assume(0)
+#else
+#  define MKTL_LIKELY(condition) (!!(condition))
+#  define MKTL_UNLIKELY(condition) (!!(condition))
+#  define MKTL_COLD
+#  define MKTL_UNREACHABLE() ((void)0)
+#endif
+
+/* Tells the optimizer the condition holds. Undefined behaviour if it does not, and the condition must have no side
+ * effects, since some compilers evaluate it and some do not. MKTL_ASSUME_IS_HINT is 1 where the assumption is a pure
+ * hint, and 0 where it is a branch to __builtin_unreachable, which GCC before 13 keeps around long enough to stop a
+ * loop containing it from being vectorized. */
+#if defined(__clang__) && defined(__has_builtin)
+#  if __has_builtin(__builtin_assume)
+#    define MKTL_ASSUME(condition) __builtin_assume(condition)
+#    define MKTL_ASSUME_IS_HINT 1
+#  endif
+#endif
+#if !defined(MKTL_ASSUME) && defined(__GNUC__) && defined(__has_attribute)
+#  if __has_attribute(assume)
+#    define MKTL_ASSUME(condition) __attribute__((assume(condition)))
+#    define MKTL_ASSUME_IS_HINT 1
+#  endif
+#endif
+#if !defined(MKTL_ASSUME)
+#  if defined(__GNUC__)
+#    define MKTL_ASSUME(condition) do { if(!(condition)) __builtin_unreachable(); } while(0)
+#    define MKTL_ASSUME_IS_HINT 0
+#  elif defined(_MSC_VER)
+#    define MKTL_ASSUME(condition) __assume(condition)
+#    define MKTL_ASSUME_IS_HINT 1
+#  else
+#    define MKTL_ASSUME(condition) ((void)0)
+#    define MKTL_ASSUME_IS_HINT 1
+#  endif
+#endif
+
+/*************************************
+ * Assertions
+ *
+ * MKTL_ASSERT is for invariants that are cheap next to the work around them, MKTL_DEBUG_ASSERT is for hot paths such
+ * as element access. Which of them are checked is picked at compile time with MKTL_CHECK_LEVEL:
+ *   MKTL_CHECK_NONE    nothing is checked
+ *   MKTL_CHECK_ASSERT  MKTL_ASSERT is checked (the default with NDEBUG)
+ *   MKTL_CHECK_ALL     both are checked (the default otherwise)
+ * An unchecked assertion turns into MKTL_ASSUME, so the optimizer can still drop bounds checks that follow from it.
+ * Where MKTL_ASSUME would be a branch (MKTL_ASSUME_IS_HINT is 0) it compiles to nothing instead, as keeping loops
+ * vectorizable is worth more than the hint.
+ *************************************/
+
+#define MKTL_CHECK_NONE 0
+#define MKTL_CHECK_ASSERT 1
+#define MKTL_CHECK_ALL 2
+
+#if !defined(MKTL_CHECK_LEVEL)
+#  if defined(PSNIP_NDEBUG)
+#    define MKTL_CHECK_LEVEL MKTL_CHECK_ASSERT
+#  else
+#    define MKTL_CHECK_LEVEL MKTL_CHECK_ALL
+#  endif
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace mckrueg::stl::detail{
+
+    /**
+     * \brief Reports a failed assertion, breaks into the debugger, then aborts if execution is continued.
+     * Kept cold and out of line so a check costs its callers one compare and a branch that is never taken.
+     */
+    [[noreturn]] MKTL_COLD inline void assertion_failed(const char* condition, const char* message, const char* file, int line) noexcept {
+        std::fprintf(stderr, "Assertion failed: %s\n\t Message: %s\n\t At: %s:%d\n", condition, message, file, line);
+        std::fflush(stderr);
+        MKTL_DEBUG_BREAK();
+        std::abort();
+    }
+
+}
+
+#define MKTL_CHECKED_ASSERT(condition, message) \
+    do { \
+        if(MKTL_UNLIKELY(!(condition))) { \
+            ::mckrueg::stl::detail::assertion_failed(#condition, message, __FILE__, __LINE__); \
+        } \
+    } while(0)
+
+#if MKTL_ASSUME_IS_HINT
+#  define MKTL_UNCHECKED_ASSERT(condition) MKTL_ASSUME(condition)
+#else
+#  define MKTL_UNCHECKED_ASSERT(condition) ((void)sizeof(!(condition)))
+#endif
+
+#if MKTL_CHECK_LEVEL >= MKTL_CHECK_ASSERT
+#  define MKTL_ASSERT(condition, message) MKTL_CHECKED_ASSERT(condition, message)
+#else
+#  define MKTL_ASSERT(condition, message) MKTL_UNCHECKED_ASSERT(condition)
+#endif
+
+#if MKTL_CHECK_LEVEL >= MKTL_CHECK_ALL
+#  define MKTL_DEBUG_ASSERT(condition, message) MKTL_CHECKED_ASSERT(condition, message)
+#else
+#  define MKTL_DEBUG_ASSERT(condition, message) MKTL_UNCHECKED_ASSERT(condition)
+#endif
+
 #endif //MKSTL_TRAPS_HPP
@@ -0,0 +1,206 @@
+/********************************************************************************
+ *  MCKRUEG STL - mckrueg's standard template library of C++ useful stuff       *
+ *  Copyright (C) 2024 Matthew Krueger <contact@matthewkrueger.com>             *
+ *                                                                              *
+ *  This program is free software: you can redistribute it and/or modify        *
+ *  it under the terms of the GNU General Public License as published by        *
+ *  the Free Software Foundation, either version 3 of the License, or           *
+ *  (at your option) any later version.                                         *
+ *                                                                              *
+ *  This program is distributed in the hope that it will be useful,             *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the               *
+ *  GNU General Public License for more details.                                *
+ *                                                                              *
+ *  You should have received a copy of the GNU General Public License           *
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.      *
+ ********************************************************************************/
+
+/*************************************
+ * The mckrueg stl requires
+ * C++ 17
+ *************************************/
+
+#if __cplusplus < 201703L
+# error MCKRUEG STL requires the use of C++ 17
+#endif
+
+#ifndef MKTL_WORK_STEALING_DEQUE_HPP
+#define MKTL_WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace mckrueg::stl{
+
+    /**
+     * \brief A Chase-Lev work stealing deque.
+     * The owning thread pushes and pops at the bottom, any other thread steals from the top. This follows the C11
+     * version from Le, Pop, Cohen and Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models".
+     * \note The buffer grows when full. Old buffers are kept until the deque is destroyed, since a thief may still be
+     * reading from one.
+     * @tparam T The element type. Must be trivially copyable, in practice a pointer to a task.
+     */
+    template<typename T>
+    class WorkStealingDeque{
+        static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque elements must be trivially copyable");
+
+    public:
+        /**
+         * \brief Creates an empty deque
+         * @param capacity The starting capacity, rounded up to a power of two
+         */
+        explicit WorkStealingDeque(std::size_t capacity = 256);
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+        /**
+         * \brief Pushes an element at the bottom. Owner only
+         * @param item The element
+         */
+        void push(T item);
+
+        /**
+         * \brief Pops the most recently pushed element. Owner only
+         * @param out Receives the element
+         * @return if an element was popped
+         */
+        bool pop(T& out) noexcept;
+
+        /**
+         * \brief Steals the oldest element. Safe from any thread
+         * \note Can fail spuriously when it loses a race against another thief or the owner
+         * @param out Receives the element
+         * @return if an element was stolen
+         */
+        bool steal(T& out) noexcept;
+
+        /**
+         * \brief A racy estimate of how many elements are queued
+         * @return The estimated size
+         */
+        [[nodiscard]] std::size_t size_estimate() const noexcept;
+
+    private:
+        struct Buffer{
+            explicit Buffer(std::size_t capacity) : mask(capacity - 1), slots(new std::atomic<T>[capacity]){}
+
+            inline std::size_t capacity() const noexcept { return mask + 1; }
+            inline T get(std::int64_t index) const noexcept {
+                return slots[static_cast<std::size_t>(index) & mask].load(std::memory_order_relaxed);
+            }
+            inline void put(std::int64_t index, T item) noexcept {
+                slots[static_cast<std::size_t>(index) & mask].store(item, std::memory_order_relaxed);
+            }
+
+            std::size_t mask;
+            std::unique_ptr<std::atomic<T>[]> slots;
+        };
+
+        Buffer* grow(Buffer* pBuffer, std::int64_t bottom, std::int64_t top);
+
+        // top is written by thieves and bottom by the owner, keep them off each other's cache line
+        alignas(64) std::atomic<std::int64_t> m_Top{0};
+        alignas(64) std::atomic<std::int64_t> m_Bottom{0};
+        alignas(64) std::atomic<Buffer*> m_pBuffer{nullptr};
+        std::vector<std::unique_ptr<Buffer>> m_Buffers;
+    };
+
+
+    template<typename T>
+    WorkStealingDeque<T>::WorkStealingDeque(std::size_t capacity){
+        std::size_t rounded = 2;
+        while(rounded < capacity){
+            rounded <<= 1;
+        }
+        m_Buffers.push_back(std::make_unique<Buffer>(rounded));
+        m_pBuffer.store(m_Buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    template<typename T>
+    typename WorkStealingDeque<T>::Buffer* WorkStealingDeque<T>::grow(Buffer* pBuffer, std::int64_t bottom, std::int64_t top){
+        auto grown = std::make_unique<Buffer>(pBuffer->capacity() * 2);
+        for(std::int64_t i = top; i < bottom; ++i){
+            grown->put(i, pBuffer->get(i));
+        }
+
+        Buffer* pGrown = grown.get();
+        m_Buffers.push_back(std::move(grown));
+        m_pBuffer.store(pGrown, std::memory_order_release);
+        return pGrown;
+    }
+
+    template<typename T>
+    void WorkStealingDeque<T>::push(T item){
+        const std::int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+        const std::int64_t top = m_Top.load(std::memory_order_acquire);
+        Buffer* pBuffer = m_pBuffer.load(std::memory_order_relaxed);
+
+        if(bottom - top > static_cast<std::int64_t>(pBuffer->capacity()) - 1){
+            pBuffer = grow(pBuffer, bottom, top);
+        }
+
+        pBuffer->put(bottom, item);
+        // A release store rather than the paper's release fence, same ordering but visible to thread sanitizers
+        m_Bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    template<typename T>
+    bool WorkStealingDeque<T>::pop(T& out) noexcept {
+        const std::int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+        Buffer* pBuffer = m_pBuffer.load(std::memory_order_relaxed);
+        m_Bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t top = m_Top.load(std::memory_order_relaxed);
+
+        if(top > bottom){
+            // was already empty
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        out = pBuffer->get(bottom);
+        if(top != bottom){
+            return true;
+        }
+
+        // Last element, race the thieves for it
+        const bool won = m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    template<typename T>
+    bool WorkStealingDeque<T>::steal(T& out) noexcept {
+        std::int64_t top = m_Top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+
+        if(top >= bottom){
+            return false;
+        }
+
+        Buffer* pBuffer = m_pBuffer.load(std::memory_order_acquire);
+        T item = pBuffer->get(top);
+        if(!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)){
+            return false;
+        }
+
+        out = item;
+        return true;
+    }
+
+    template<typename T>
+    std::size_t WorkStealingDeque<T>::size_estimate() const noexcept {
+        const std::int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+        const std::int64_t top = m_Top.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
+    }
+
+}
+
+#endif //MKTL_WORK_STEALING_DEQUE_HPP
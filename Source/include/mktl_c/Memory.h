@@ -35,6 +35,8 @@ __MKTL_API void* operator new(size_t bytes);
 __MKTL_API void* operator new[](size_t bytes);
 __MKTL_API void operator delete(void* pVoid) noexcept;
 __MKTL_API void operator delete[](void* pVoid) noexcept;
+__MKTL_API void operator delete(void* pVoid, size_t bytes) noexcept;
+__MKTL_API void operator delete[](void* pVoid, size_t bytes) noexcept;
 
 extern "C" {
 #endif
@@ -57,7 +59,8 @@ struct PointerInfo{
 };
 
 /**
- * A pAllocator that tracks memory allocations
+ * A pAllocator that tracks memory allocations. The tracker takes a lock, so this and the functions below are safe to
+ * call from any thread.
  * @param bytes The size of the pointer
  * @return The pointer
  */
@@ -83,6 +86,52 @@ __MKTL_API unsigned long long getTotalBytesDeallocated();
 __MKTL_API unsigned long long getDeallocationCount();
 __MKTL_API unsigned long long getBytesCurrentlyAllocated();
 
+/**
+ * Counters for the per-worker allocation arenas of the thread pool. Arenas take their slabs from the allocator above,
+ * so slab memory also shows up in the totals above.
+ */
+struct ArenaStats{
+    unsigned long long bytesReserved;           /* slab bytes the arenas hold */
+    unsigned long long allocationCount;         /* blocks handed out */
+    unsigned long long deallocationCount;       /* blocks freed by the thread that owns them */
+    unsigned long long remoteDeallocationCount; /* blocks freed by any other thread */
+};
+
+/**
+ * Get the arena counters, summed over every arena that exists or has existed
+ * @return The arena counters
+ */
+__MKTL_API struct ArenaStats getArenaStats();
+
+/**
+ * Counters for the inline capacity containers (SmallVector, SmallString). A spill is a container outgrowing its inline
+ * storage for the first time, a regrowth is a container that already spilled growing its heap buffer again.
+ */
+struct InlineSpillStats{
+    unsigned long long spillCount;
+    unsigned long long spillBytes;
+    unsigned long long regrowthCount;
+    unsigned long long regrowthBytes;
+};
+
+/**
+ * Record a container moving from inline storage to the heap
+ * @param bytes The size of the heap buffer
+ */
+__MKTL_API void recordInlineSpill(unsigned long bytes);
+
+/**
+ * Record a container that is already on the heap growing its buffer
+ * @param bytes The size of the new heap buffer
+ */
+__MKTL_API void recordInlineRegrowth(unsigned long bytes);
+
+/**
+ * Get the inline container counters
+ * @return The inline container counters
+ */
+__MKTL_API struct InlineSpillStats getInlineSpillStats();
+
 #ifdef __cplusplus
 }
 #endif